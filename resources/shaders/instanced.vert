@@ -0,0 +1,31 @@
+#version 330 core
+
+// Same as phong.vert, but with the model and normal matrices given per instance
+layout(location = 0) in vec3 objPos;
+layout(location = 1) in vec3 objNormal;
+layout(location = 2) in vec2 inUVCoords;
+layout(location = 3) in mat4 modelMat;  // takes up locations 3 to 6
+layout(location = 7) in mat3 normalMat; // takes up locations 7 to 9
+
+out vec4 worldPos;
+out vec4 worldNormal;
+out vec2 uvCoords;
+
+// Per-frame data, shared by all shaders (std140, mirrored by RealtimeScene::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 viewMat;
+    mat4 projMat;
+    vec4 cameraPos;
+    float ka;
+    float kd;
+    float ks;
+    bool textureMapEnabled;
+};
+
+void main() {
+    worldPos = modelMat * vec4(objPos, 1.0);
+    worldNormal = vec4(normalMat * objNormal, 0);
+    uvCoords = inUVCoords;
+
+    gl_Position = projMat * viewMat * worldPos;
+}
@@ -0,0 +1,71 @@
+#version 330 core
+
+// Reconstructs the surface of a jello cube from its lattice's node positions. Each vertex of a face's grid
+// only knows its node, and the nodes before and after it along the grid's two axes (ordered so that their
+// differences' cross product faces out of the cube); its position and normal are fetched from the lattice.
+// Alternatively, an embedded render mesh is drawn: each of its vertices is bound to a lattice cell (by the cell's first
+// node) and its coordinates within it, and follows the cell's trilinear deformation.
+layout(location = 0) in int node;
+layout(location = 1) in ivec4 neighbours;
+layout(location = 2) in vec2 inUVCoords;
+layout(location = 3) in vec3 cellCoords;
+layout(location = 4) in vec3 restNormal;
+
+out vec4 worldPos;
+out vec4 worldNormal;
+out vec2 uvCoords;
+
+// Object-space node positions, starting at nodeOffset
+uniform samplerBuffer nodePositions;
+uniform int nodeOffset;
+uniform bool embedded;
+uniform int latticeSize; // nodes along each of the lattice's axes
+
+uniform mat4 modelMat;
+uniform mat3 normalMat;
+// Per-frame data, shared by all shaders (std140, mirrored by RealtimeScene::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 viewMat;
+    mat4 projMat;
+    vec4 cameraPos;
+    float ka;
+    float kd;
+    float ks;
+    bool textureMapEnabled;
+};
+
+vec3 fetchNode(int ind) {
+    return texelFetch(nodePositions, nodeOffset + ind).xyz;
+}
+
+void main() {
+    vec3 objPos, objNormal;
+    if(embedded) {
+        // The cell's corners, indexed by their offsets along x, y and z as the bits of 4x + 2y + z
+        vec3 c[8];
+        for(int i = 0; i < 8; i++) {
+            c[i] = fetchNode(node + (i >> 2) * latticeSize * latticeSize + ((i >> 1) & 1) * latticeSize + (i & 1));
+        }
+        vec3 t = cellCoords;
+        // Interpolate along z, then y, then x, keeping the derivatives along each axis
+        vec3 z00 = mix(c[0], c[1], t.z), z01 = mix(c[2], c[3], t.z);
+        vec3 z10 = mix(c[4], c[5], t.z), z11 = mix(c[6], c[7], t.z);
+        vec3 y0 = mix(z00, z01, t.y), y1 = mix(z10, z11, t.y);
+        objPos = mix(y0, y1, t.x);
+        vec3 dx = y1 - y0;
+        vec3 dy = mix(z01 - z00, z11 - z10, t.x);
+        vec3 dz = mix(mix(c[1] - c[0], c[3] - c[2], t.y), mix(c[5] - c[4], c[7] - c[6], t.y), t.x);
+        // Normals transform by the cofactor matrix of the deformation's Jacobian
+        objNormal = restNormal.x * cross(dy, dz) + restNormal.y * cross(dz, dx) + restNormal.z * cross(dx, dy);
+    } else {
+        objPos = fetchNode(node);
+        // Area-weighted normal of the quadrilateral spanned by the neighbours
+        objNormal = cross(fetchNode(neighbours.y) - fetchNode(neighbours.x), fetchNode(neighbours.w) - fetchNode(neighbours.z));
+    }
+
+    worldPos = modelMat * vec4(objPos, 1.0);
+    worldNormal = vec4(normalMat * objNormal, 0);
+    uvCoords = inUVCoords;
+
+    gl_Position = projMat * viewMat * worldPos;
+}
@@ -6,10 +6,16 @@ in vec2 uvCoords;
 
 out vec4 fragColor;
 
-// Global data
-uniform float ka;
-uniform float kd;
-uniform float ks;
+// Per-frame data, shared by all shaders (std140, mirrored by RealtimeScene::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 viewMat;
+    mat4 projMat;
+    vec4 cameraPos;
+    float ka;
+    float kd;
+    float ks;
+    bool textureMapEnabled;
+};
 
 // Material data
 uniform vec4 materialAmbient;
@@ -20,27 +26,26 @@ uniform bool textured;
 uniform sampler2D texture;
 uniform float materialBlend;
 
-uniform bool textureMapEnabled;
-
 // Light data
 const int LIGHT_POINT = 0;
 const int LIGHT_DIRECTIONAL = 1;
 const int LIGHT_SPOT = 2;
+// Ordered so that std140 packs it without padding between members (mirrored by RealtimeScene::LightBlock)
 struct LightData {
-    int type;
     vec4 color;
-
-    vec3 function;
     vec4 pos;
     vec4 dir;
 
+    vec3 function;
+    int type;
+
     float penumbra;
     float angle;
 };
-uniform LightData lights[8];
-uniform int numLights;
-
-uniform vec4 cameraPos;
+layout(std140) uniform Lights {
+    LightData lights[8];
+    int numLights;
+};
 
 void main() {
     vec4 normalizedNormal = normalize(worldNormal);
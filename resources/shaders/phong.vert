@@ -10,8 +10,16 @@ out vec2 uvCoords;
 
 uniform mat4 modelMat;
 uniform mat3 normalMat;
-uniform mat4 viewMat;
-uniform mat4 projMat;
+// Per-frame data, shared by all shaders (std140, mirrored by RealtimeScene::FrameBlock)
+layout(std140) uniform Frame {
+    mat4 viewMat;
+    mat4 projMat;
+    vec4 cameraPos;
+    float ka;
+    float kd;
+    float ks;
+    bool textureMapEnabled;
+};
 
 void main() {
     worldPos = modelMat * vec4(objPos, 1.0);
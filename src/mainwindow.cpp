@@ -42,6 +42,27 @@ void MainWindow::initialize() {
     });
     vLayout->addWidget(add);
 
+    QPushButton* addMoving = new QPushButton();
+    addMoving->setText(QStringLiteral("Add moving obstacle"));
+    connect(addMoving, &QPushButton::clicked, this, [addMoving, this]() {
+        this->realtime->addMovingObstacle();
+    });
+    vLayout->addWidget(addMoving);
+
+    QPushButton* addTerrain = new QPushButton();
+    addTerrain->setText(QStringLiteral("Add terrain"));
+    connect(addTerrain, &QPushButton::clicked, this, [addTerrain, this]() {
+        this->realtime->addTerrain();
+    });
+    vLayout->addWidget(addTerrain);
+
+    QPushButton* addCube = new QPushButton();
+    addCube->setText(QStringLiteral("Add cube"));
+    connect(addCube, &QPushButton::clicked, this, [addCube, this]() {
+        this->realtime->addJelloCube();
+    });
+    vLayout->addWidget(addCube);
+
     // Add simulation parameters
     QFont font;
     font.setPointSize(12);
@@ -58,6 +79,12 @@ void MainWindow::initialize() {
     this->addSlider(vLayout, "Damping constant (bounds)", 0.1, 20, 0.05, settings.dCollision, 20, &settings.dCollision);
     this->addSlider(vLayout, "Node mass", 0.01, 100, 0.01, settings.mass, 100, &settings.mass);
     this->addSlider(vLayout, "Gravity", 0, 3, 0.1, settings.gravity, 100, &settings.gravity);
+    this->addSlider(vLayout, "Static friction", 0, 2, 0.05, settings.staticFriction, 20, &settings.staticFriction);
+    this->addSlider(vLayout, "Dynamic friction", 0, 2, 0.05, settings.dynamicFriction, 20, &settings.dynamicFriction);
+    this->addSlider(vLayout, "Contact substeps (multirate)", 1, 16, 1, settings.contactSubsteps, 1, &settings.contactSubsteps);
+    this->addSlider(vLayout, "Time step safety factor (automatic)", 0.1, 1, 0.05, settings.timestepSafety, 20, &settings.timestepSafety);
+    this->addSlider(vLayout, "Minimum stretch (strain limiting)", 0.1, 1, 0.05, settings.minStretch, 20, &settings.minStretch);
+    this->addSlider(vLayout, "Maximum stretch (strain limiting)", 1, 3, 0.05, settings.maxStretch, 20, &settings.maxStretch);
 
     // Add other scene options
     QLabel* options_label = new QLabel(); // Options label
@@ -80,6 +107,70 @@ void MainWindow::initialize() {
         settings.transparentCube = !settings.transparentCube;
     });
     vLayout->addWidget(transparent);
+
+    QCheckBox* lod = new QCheckBox();
+    lod->setText(QStringLiteral("Simulation LOD"));
+    lod->setChecked(settings.simulationLOD);
+    connect(lod, &QCheckBox::clicked, this, [lod, this]{
+        settings.simulationLOD = !settings.simulationLOD;
+    });
+    vLayout->addWidget(lod);
+
+    QCheckBox* renderMesh = new QCheckBox();
+    renderMesh->setText(QStringLiteral("Embedded Render Mesh"));
+    renderMesh->setChecked(settings.embeddedRenderMesh);
+    connect(renderMesh, &QCheckBox::clicked, this, [renderMesh, this]{
+        settings.embeddedRenderMesh = !settings.embeddedRenderMesh;
+    });
+    vLayout->addWidget(renderMesh);
+
+    QCheckBox* stats = new QCheckBox();
+    stats->setText(QStringLiteral("Print Render Stats"));
+    stats->setChecked(settings.renderStats);
+    connect(stats, &QCheckBox::clicked, this, [stats, this]{
+        settings.renderStats = !settings.renderStats;
+    });
+    vLayout->addWidget(stats);
+
+    QCheckBox* multirate = new QCheckBox();
+    multirate->setText(QStringLiteral("Multirate Contact Stepping"));
+    multirate->setChecked(settings.integrator == Integrator::MULTIRATE);
+    connect(multirate, &QCheckBox::clicked, this, [multirate, this]{
+        settings.integrator = settings.integrator == Integrator::MULTIRATE ? Integrator::RK4 : Integrator::MULTIRATE;
+    });
+    vLayout->addWidget(multirate);
+
+    QCheckBox* penalty = new QCheckBox();
+    penalty->setText(QStringLiteral("Penalty Contacts (no friction)"));
+    penalty->setChecked(settings.contactModel == ContactModel::PENALTY);
+    connect(penalty, &QCheckBox::clicked, this, [penalty, this]{
+        settings.contactModel = settings.contactModel == ContactModel::PENALTY ? ContactModel::CONSTRAINT : ContactModel::PENALTY;
+    });
+    vLayout->addWidget(penalty);
+
+    QCheckBox* continuousCollisions = new QCheckBox();
+    continuousCollisions->setText(QStringLiteral("Continuous Collisions"));
+    continuousCollisions->setChecked(settings.continuousCollisions);
+    connect(continuousCollisions, &QCheckBox::clicked, this, [continuousCollisions, this]{
+        settings.continuousCollisions = !settings.continuousCollisions;
+    });
+    vLayout->addWidget(continuousCollisions);
+
+    QCheckBox* autoTimestep = new QCheckBox();
+    autoTimestep->setText(QStringLiteral("Automatic Time Step"));
+    autoTimestep->setChecked(settings.autoTimestep);
+    connect(autoTimestep, &QCheckBox::clicked, this, [autoTimestep, this]{
+        settings.autoTimestep = !settings.autoTimestep;
+    });
+    vLayout->addWidget(autoTimestep);
+
+    QCheckBox* strainLimiting = new QCheckBox();
+    strainLimiting->setText(QStringLiteral("Strain Limiting"));
+    strainLimiting->setChecked(settings.strainLimiting);
+    connect(strainLimiting, &QCheckBox::clicked, this, [strainLimiting, this]{
+        settings.strainLimiting = !settings.strainLimiting;
+    });
+    vLayout->addWidget(strainLimiting);
 }
 
 void MainWindow::finish() {
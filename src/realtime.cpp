@@ -30,7 +30,10 @@ void Realtime::finish() {
     this->makeCurrent();
 
     // Students: anything requiring OpenGL calls when the program exits should be done here
-    glErrorCheck(glDeleteProgram(this->phongShader));
+    glErrorCheck(glDeleteProgram(this->phongShader.program));
+    glErrorCheck(glDeleteProgram(this->jelloShader.program));
+    glErrorCheck(glDeleteProgram(this->instancedShader.program));
+    this->instancedRenderer.free();
     this->scene.free();
 
     this->doneCurrent();
@@ -65,11 +68,26 @@ void Realtime::initializeGL() {
     glErrorCheck(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
     glErrorCheck(glBlendEquation(GL_FUNC_ADD));
 
-    // Initialize all shaders, set any textures they use to the used texture slot
-    this->phongShader = ShaderLoader::createShaderProgram("resources/shaders/phong.vert", "resources/shaders/phong.frag");
+    // Initialize all shaders, resolve their uniforms, and set any textures they use to the used texture slot
+    this->phongShader.resolve(ShaderLoader::createShaderProgram("resources/shaders/phong.vert", "resources/shaders/phong.frag"));
     glErrorCheck();
-    glErrorCheck(glUseProgram(this->phongShader));
-    glErrorCheck(glUniform1i(glGetUniformLocation(this->phongShader, "texture"), 0));
+    glErrorCheck(glUseProgram(this->phongShader.program));
+    glErrorCheck(glUniform1i(glGetUniformLocation(this->phongShader.program, "texture"), 0));
+    glErrorCheck(glUseProgram(0));
+
+    // The jello cubes' surfaces are reconstructed on the GPU, from their node positions in texture slot 1
+    this->jelloShader.resolve(ShaderLoader::createShaderProgram("resources/shaders/jello.vert", "resources/shaders/phong.frag"));
+    glErrorCheck();
+    glErrorCheck(glUseProgram(this->jelloShader.program));
+    glErrorCheck(glUniform1i(glGetUniformLocation(this->jelloShader.program, "texture"), 0));
+    glErrorCheck(glUniform1i(glGetUniformLocation(this->jelloShader.program, "nodePositions"), 1));
+    glErrorCheck(glUseProgram(0));
+
+    // Primitives sharing geometry and material are drawn as instances, with their transformations as vertex attributes
+    this->instancedShader.resolve(ShaderLoader::createShaderProgram("resources/shaders/instanced.vert", "resources/shaders/phong.frag"));
+    glErrorCheck();
+    glErrorCheck(glUseProgram(this->instancedShader.program));
+    glErrorCheck(glUniform1i(glGetUniformLocation(this->instancedShader.program, "texture"), 0));
     glErrorCheck(glUseProgram(0));
 
     scene.initScene();
@@ -83,17 +101,34 @@ void Realtime::paintGL() {
     // Clear screen color and depth before painting
     glErrorCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
-    // Activate shader program
-    glErrorCheck(glUseProgram(this->phongShader));
-
-    this->scene.bindSceneUniforms(this->phongShader);
-    glErrorCheck(glUniform1i(glGetUniformLocation(this->phongShader, "textureMapEnabled"), settings.textureMappingEnabled));
-
-    for(const std::unique_ptr<Primitive>& primitive : this->scene.getPrimitives())
-        primitive->draw(this->phongShader);
-
-    // Deactivate shader program
-    glErrorCheck(glUseProgram(0));
+    // Refresh the uniform blocks shared by all shaders
+    this->scene.updateSceneUniforms();
+
+    // Queue all primitives but the jello cubes (which come last): those sharing geometry and material as one
+    // batch of instances each, and the rest one by one with the phong shader
+    std::vector<std::unique_ptr<Primitive>>& primitives = this->scene.getPrimitives();
+    std::span<std::unique_ptr<Primitive>> jelloCubes = this->scene.getJelloCubes();
+    this->renderQueue.begin(this->scene.getCamera().getPosition());
+    this->instancedRenderer.prepare(std::span(primitives).first(primitives.size() - jelloCubes.size()));
+    for(int batch = 0; batch < this->instancedRenderer.getNumBatches(); batch++)
+        this->renderQueue.addInstances(this->instancedRenderer, batch, this->instancedShader);
+    for(const Primitive* primitive : this->instancedRenderer.getUnbatched())
+        this->renderQueue.add(*primitive, this->phongShader);
+
+    // Then the jello cubes, whose surfaces are reconstructed from their node positions on the GPU
+    for(const std::unique_ptr<Primitive>& jelloCube : jelloCubes)
+        this->renderQueue.add(*jelloCube, this->jelloShader);
+
+    // Draw everything sorted by state, then unbind it
+    this->renderQueue.flush();
+    this->instancedRenderer.fence();
+
+    const RenderStats& stats = this->renderQueue.getStats();
+    if(settings.renderStats && stats != this->lastStats) {
+        std::cout << "Render queue: " << stats.draws << " draws, " << stats.programChanges << " program, " << stats.vaoChanges << " VAO, "
+                  << stats.textureChanges << " texture and " << stats.materialChanges << " material changes" << std::endl;
+    }
+    this->lastStats = settings.renderStats ? stats : RenderStats();
 }
 
 void Realtime::resizeGL(int w, int h) {
@@ -118,6 +153,24 @@ void Realtime::addObstacle() {
     update(); // asks for a PaintGL() call to occur
 }
 
+void Realtime::addMovingObstacle() {
+    this->makeCurrent();
+    this->scene.addMovingObstacle();
+    update(); // asks for a PaintGL() call to occur
+}
+
+void Realtime::addTerrain() {
+    this->makeCurrent();
+    this->scene.addTerrain();
+    update(); // asks for a PaintGL() call to occur
+}
+
+void Realtime::addJelloCube() {
+    this->makeCurrent();
+    this->scene.addJelloCube();
+    update(); // asks for a PaintGL() call to occur
+}
+
 // ================== Project 6: Action!
 
 void Realtime::keyPressEvent(QKeyEvent *event) {
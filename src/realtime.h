@@ -14,6 +14,8 @@
 #include <QTimer>
 
 #include "scene/realtimescene.h"
+#include "scene/instancedrenderer.h"
+#include "scene/renderqueue.h"
 #include "settings.h"
 
 class Realtime : public QOpenGLWidget
@@ -24,6 +26,9 @@ public:
 
     void resetScene();
     void addObstacle();
+    void addMovingObstacle();
+    void addTerrain();
+    void addJelloCube();
 
     RealtimeScene scene;
 public slots:
@@ -57,5 +62,10 @@ private:
     int screenHeight;
 
     // Stores any scene-related data
-    GLuint phongShader;
+    ShaderUniforms phongShader;
+    ShaderUniforms jelloShader;
+    ShaderUniforms instancedShader;
+    InstancedRenderer instancedRenderer;
+    RenderQueue renderQueue;
+    RenderStats lastStats; // printed whenever they change, if enabled
 };
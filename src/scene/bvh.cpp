@@ -0,0 +1,299 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// Finds the closest point on a triangle to the given point, by determining which of the triangle's
+// vertex, edge or face regions the point projects into (see Ericson, Real-Time Collision Detection, 5.1.5)
+static glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if(d1 <= 0 && d2 <= 0) {
+        return a;
+    }
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if(d3 >= 0 && d4 <= d3) {
+        return b;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0) {
+        return a + d1 / (d1 - d3) * ab;
+    }
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if(d6 >= 0 && d5 <= d6) {
+        return c;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0) {
+        return a + d2 / (d2 - d6) * ac;
+    }
+    float va = d3 * d6 - d5 * d4;
+    if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+    }
+    float denom = 1 / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+static float surfaceArea(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0));
+    return 2 * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+static float boxDistanceSq(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3 point) {
+    glm::vec3 offset = glm::max(glm::max(boundsMin - point, point - boundsMax), glm::vec3(0));
+    return glm::dot(offset, offset);
+}
+
+void TriangleBVH::build(const std::vector<glm::vec3>& positions, const std::vector<int>& positionInds) {
+    int numTriangles = positionInds.size() / 3;
+    this->triangles.resize(numTriangles);
+    this->centroids.resize(numTriangles);
+    this->order.resize(numTriangles);
+    for(int t = 0; t < numTriangles; t++) {
+        Triangle& triangle = this->triangles[t];
+        triangle = {positions[positionInds[3 * t]], positions[positionInds[3 * t + 1]], positions[positionInds[3 * t + 2]]};
+        this->centroids[t] = (triangle.a + triangle.b + triangle.c) / 3.0f;
+        this->order[t] = t;
+    }
+
+    // A binary tree with at least one triangle per leaf has fewer than twice as many nodes as triangles
+    this->nodes.clear();
+    this->nodes.reserve(2 * std::max(numTriangles, 1));
+    this->buildNode(0, numTriangles, 0);
+
+    // Store the triangles in the order of the leaves that contain them
+    std::vector<Triangle> ordered(numTriangles);
+    for(int i = 0; i < numTriangles; i++) {
+        ordered[i] = this->triangles[this->order[i]];
+    }
+    this->triangles = std::move(ordered);
+    this->centroids = std::vector<glm::vec3>();
+    this->order = std::vector<int>();
+}
+
+// Builds the subtree over the triangles order[start, start + count), returning the index of its root. The triangles are split
+// at whichever of the boundaries between equally sized bins (along the axis of greatest spread of their centroids) minimizes the
+// surface area heuristic, unless keeping them in a single leaf is cheaper.
+int TriangleBVH::buildNode(int start, int count, int depth) {
+    int index = this->nodes.size();
+    this->nodes.push_back(Node());
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+    glm::vec3 centroidMin = boundsMin, centroidMax = boundsMax;
+    for(int i = start; i < start + count; i++) {
+        const Triangle& triangle = this->triangles[this->order[i]];
+        boundsMin = glm::min(boundsMin, glm::min(triangle.a, glm::min(triangle.b, triangle.c)));
+        boundsMax = glm::max(boundsMax, glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+        centroidMin = glm::min(centroidMin, this->centroids[this->order[i]]);
+        centroidMax = glm::max(centroidMax, this->centroids[this->order[i]]);
+    }
+    this->nodes[index] = {boundsMin, start, boundsMax, count};
+
+    glm::vec3 spread = centroidMax - centroidMin;
+    int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+    if(count <= this->maxLeafSize || spread[axis] <= 0 || depth + 2 >= maxDepth) {
+        return index;
+    }
+
+    // Bin the triangles by their centroids
+    struct Bin {
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        int count = 0;
+    };
+    std::vector<Bin> bins(this->numBins);
+    float binScale = this->numBins / spread[axis];
+    auto getBin = [this, axis, binScale, &centroidMin](int triangle) {
+        return std::min((int) ((this->centroids[triangle][axis] - centroidMin[axis]) * binScale), this->numBins - 1);
+    };
+    for(int i = start; i < start + count; i++) {
+        const Triangle& triangle = this->triangles[this->order[i]];
+        Bin& bin = bins[getBin(this->order[i])];
+        bin.boundsMin = glm::min(bin.boundsMin, glm::min(triangle.a, glm::min(triangle.b, triangle.c)));
+        bin.boundsMax = glm::max(bin.boundsMax, glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+        bin.count++;
+    }
+
+    // Sweep from the right to find the cost of each right side, then from the left to find the cheapest split.
+    // Costs are relative to the cost of intersecting a single triangle, with traversal costing the same.
+    std::vector<float> rightCosts(this->numBins, 0);
+    Bin right;
+    for(int b = this->numBins - 1; b > 0; b--) {
+        right.boundsMin = glm::min(right.boundsMin, bins[b].boundsMin);
+        right.boundsMax = glm::max(right.boundsMax, bins[b].boundsMax);
+        right.count += bins[b].count;
+        rightCosts[b] = right.count == 0 ? 0 : right.count * surfaceArea(right.boundsMin, right.boundsMax);
+    }
+    Bin left;
+    int bestSplit = -1;
+    float bestCost = std::numeric_limits<float>::max();
+    for(int b = 1; b < this->numBins; b++) {
+        left.boundsMin = glm::min(left.boundsMin, bins[b - 1].boundsMin);
+        left.boundsMax = glm::max(left.boundsMax, bins[b - 1].boundsMax);
+        left.count += bins[b - 1].count;
+        float cost = (left.count == 0 ? 0 : left.count * surfaceArea(left.boundsMin, left.boundsMax)) + rightCosts[b];
+        if(left.count > 0 && left.count < count && cost < bestCost) {
+            bestCost = cost;
+            bestSplit = b;
+        }
+    }
+    float area = surfaceArea(boundsMin, boundsMax);
+    if(bestSplit == -1 || (area > 0 && 1 + bestCost / area >= count && count <= 4 * this->maxLeafSize)) {
+        return index;
+    }
+
+    int mid = std::partition(this->order.begin() + start, this->order.begin() + start + count, [&getBin, bestSplit](int triangle) {
+        return getBin(triangle) < bestSplit;
+    }) - this->order.begin();
+
+    this->nodes[index].count = 0;
+    this->buildNode(start, mid - start, depth + 1); // the first child directly follows
+    this->nodes[index].start = this->buildNode(mid, start + count - mid, depth + 1);
+    return index;
+}
+
+glm::vec3 TriangleBVH::findClosestPoint(glm::vec3 point) const {
+    glm::vec3 closest = point;
+    float closestDistSq = std::numeric_limits<float>::max();
+    int stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        int index = stack[--stackSize];
+        const Node& node = this->nodes[index];
+        if(boxDistanceSq(node.boundsMin, node.boundsMax, point) >= closestDistSq) {
+            continue;
+        }
+        if(node.count > 0) {
+            for(int t = node.start; t < node.start + node.count; t++) {
+                const Triangle& triangle = this->triangles[t];
+                glm::vec3 candidate = closestPointOnTriangle(point, triangle.a, triangle.b, triangle.c);
+                float distSq = glm::dot(candidate - point, candidate - point);
+                if(distSq < closestDistSq) {
+                    closestDistSq = distSq;
+                    closest = candidate;
+                }
+            }
+            continue;
+        }
+        // Visit the nearer child first, so that the farther one is more likely to be culled
+        int first = index + 1, second = node.start;
+        if(boxDistanceSq(this->nodes[first].boundsMin, this->nodes[first].boundsMax, point) >
+           boxDistanceSq(this->nodes[second].boundsMin, this->nodes[second].boundsMax, point)) {
+            std::swap(first, second);
+        }
+        stack[stackSize++] = second;
+        stack[stackSize++] = first;
+    }
+    return closest;
+}
+
+bool TriangleBVH::isInside(glm::vec3 point) const {
+    // A direction unlikely to run exactly along the edges or faces of a modeled mesh
+    const glm::vec3 dir = glm::normalize(glm::vec3(0.5773f, 0.5219f, 0.6281f));
+    const glm::vec3 invDir = 1.0f / dir;
+    int crossings = 0;
+    int stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        int index = stack[--stackSize];
+        const Node& node = this->nodes[index];
+        float entry;
+        if(!intersectBox(node, point, invDir, std::numeric_limits<float>::max(), entry)) {
+            continue;
+        }
+        if(node.count > 0) {
+            for(int t = node.start; t < node.start + node.count; t++) {
+                std::optional<float> time = intersectTriangle(this->triangles[t], point, dir);
+                crossings += time.has_value() && *time > 0;
+            }
+            continue;
+        }
+        stack[stackSize++] = node.start;
+        stack[stackSize++] = index + 1;
+    }
+    return crossings % 2 == 1;
+}
+
+std::optional<TriangleHit> TriangleBVH::findFirstHit(glm::vec3 start, glm::vec3 dir) const {
+    const glm::vec3 invDir = 1.0f / dir;
+    float firstTime = 1;
+    int firstTriangle = -1;
+    int stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        int index = stack[--stackSize];
+        const Node& node = this->nodes[index];
+        float entry;
+        if(!intersectBox(node, start, invDir, firstTime, entry)) {
+            continue;
+        }
+        if(node.count > 0) {
+            for(int t = node.start; t < node.start + node.count; t++) {
+                std::optional<float> time = intersectTriangle(this->triangles[t], start, dir);
+                if(time && *time >= 0 && *time <= firstTime) {
+                    firstTime = *time;
+                    firstTriangle = t;
+                }
+            }
+            continue;
+        }
+        stack[stackSize++] = node.start;
+        stack[stackSize++] = index + 1;
+    }
+    if(firstTriangle == -1) {
+        return std::nullopt;
+    }
+
+    const Triangle& triangle = this->triangles[firstTriangle];
+    glm::vec3 normal = glm::normalize(glm::cross(triangle.b - triangle.a, triangle.c - triangle.a));
+    return TriangleHit{firstTime, glm::dot(normal, dir) > 0 ? -normal : normal};
+}
+
+bool TriangleBVH::intersectBox(const Node& node, glm::vec3 origin, glm::vec3 invDir, float maxTime, float& entry) {
+    entry = 0;
+    float exit = maxTime;
+    for(int axis = 0; axis < 3; axis++) {
+        // A ray parallel to the slab either lies within it throughout or misses it; checking this directly avoids
+        // the NaNs of 0 * infinity when it runs along one of the box's faces
+        if(std::isinf(invDir[axis])) {
+            if(origin[axis] < node.boundsMin[axis] || origin[axis] > node.boundsMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float t1 = (node.boundsMin[axis] - origin[axis]) * invDir[axis];
+        float t2 = (node.boundsMax[axis] - origin[axis]) * invDir[axis];
+        entry = std::max(entry, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+    }
+    return entry <= exit;
+}
+
+// Moller-Trumbore ray-triangle intersection
+std::optional<float> TriangleBVH::intersectTriangle(const Triangle& triangle, glm::vec3 origin, glm::vec3 dir) {
+    glm::vec3 edge1 = triangle.b - triangle.a, edge2 = triangle.c - triangle.a;
+    glm::vec3 pvec = glm::cross(dir, edge2);
+    float det = glm::dot(edge1, pvec);
+    if(det == 0) {
+        return std::nullopt; // the ray runs parallel to the triangle
+    }
+    float invDet = 1 / det;
+    glm::vec3 tvec = origin - triangle.a;
+    float u = glm::dot(tvec, pvec) * invDet;
+    if(u < 0 || u > 1) {
+        return std::nullopt;
+    }
+    glm::vec3 qvec = glm::cross(tvec, edge1);
+    float v = glm::dot(dir, qvec) * invDet;
+    if(v < 0 || u + v > 1) {
+        return std::nullopt;
+    }
+    return glm::dot(edge2, qvec) * invDet;
+}
@@ -0,0 +1,68 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <optional>
+
+#include <glm/glm.hpp>
+
+// A triangle crossed by a ray or segment: the fraction of the segment covered before the crossing, and the triangle's
+// unit normal, facing back towards the segment's start
+struct TriangleHit {
+    float time;
+    glm::vec3 normal;
+};
+
+// A bounding volume hierarchy over the triangles of a mesh, built top-down by the surface area heuristic.
+// The mesh is treated as a closed solid: points can be tested for lying inside it, and pushed out to its surface.
+class TriangleBVH {
+public:
+    // Builds the hierarchy over the given triangles, given by the indices of their corners' positions (3 per triangle)
+    void build(const std::vector<glm::vec3>& positions, const std::vector<int>& positionInds);
+
+    // Finds the closest point on the mesh's surface to the given point
+    glm::vec3 findClosestPoint(glm::vec3 point) const;
+    // Checks whether the given point lies inside the mesh, by the parity of the number of times a ray from it crosses the surface
+    bool isInside(glm::vec3 point) const;
+    // Finds the first crossing of the mesh's surface along the segment from start to start + dir, if any
+    std::optional<TriangleHit> findFirstHit(glm::vec3 start, glm::vec3 dir) const;
+
+    // Returns the corners of the axis-aligned box enclosing the mesh
+    const glm::vec3& getBoundsMin() const {
+        return this->nodes[0].boundsMin;
+    }
+    const glm::vec3& getBoundsMax() const {
+        return this->nodes[0].boundsMax;
+    }
+private:
+    // Nodes are stored depth-first, so that the first child of an interior node directly follows it
+    struct Node {
+        glm::vec3 boundsMin;
+        int start; // index of the first triangle (leaves), or of the second child (interior nodes)
+        glm::vec3 boundsMax;
+        int count; // number of triangles (leaves), or 0 (interior nodes)
+    };
+    std::vector<Node> nodes;
+
+    // The triangles' corners, reordered so that the triangles of each leaf are contiguous
+    struct Triangle {
+        glm::vec3 a, b, c;
+    };
+    std::vector<Triangle> triangles;
+
+    // Scratch data used during the build
+    std::vector<glm::vec3> centroids;
+    std::vector<int> order;
+    int buildNode(int start, int count, int depth);
+
+    // Finds the distance along a ray to where it enters a node's box, returning false if it misses the box before maxTime
+    static bool intersectBox(const Node& node, glm::vec3 origin, glm::vec3 invDir, float maxTime, float& entry);
+    // Finds the distance along a ray at which it crosses a triangle, if it does
+    static std::optional<float> intersectTriangle(const Triangle& triangle, glm::vec3 origin, glm::vec3 dir);
+
+    const int maxLeafSize = 4;
+    const int numBins = 16;
+    static const int maxDepth = 64; // size of the traversal stacks
+};
+
+#endif // BVH_H
@@ -138,3 +138,7 @@ const glm::vec4& Camera::getRight() const {
 const float Camera::getAspectRatio() const {
     return this->aspectRatio;
 }
+
+const float Camera::getHeightAngle() const {
+    return this->heightAngle;
+}
@@ -43,6 +43,9 @@ public:
     // Returns the aspect ratio of the camera
     const float getAspectRatio() const;
 
+    // Returns the height angle of the camera, in radians
+    const float getHeightAngle() const;
+
 protected:
     glm::vec4 pos;
     glm::vec4 look;
@@ -0,0 +1,81 @@
+#include "instancedrenderer.h"
+#include <algorithm>
+
+void InstancedRenderer::prepare(std::span<std::unique_ptr<Primitive>> primitives) {
+    // There are few distinct geometries and materials, so the batches are searched linearly
+    for(Batch& batch : this->batches) {
+        batch.instances.clear();
+    }
+    this->unbatched.clear();
+    for(const std::unique_ptr<Primitive>& primitive : primitives) {
+        const SharedGeometry* geometry = primitive->getSharedGeometry();
+        if(geometry == nullptr) {
+            this->unbatched.push_back(primitive.get());
+            continue;
+        }
+        auto batch = std::find_if(this->batches.begin(), this->batches.end(), [&](const Batch& batch) {
+            return batch.geometry == geometry && !batch.instances.empty() &&
+                   sameMaterial(batch.first->getMaterial(), primitive->getMaterial());
+        });
+        if(batch == this->batches.end()) {
+            // Reuse an emptied batch's storage, if any
+            batch = std::find_if(this->batches.begin(), this->batches.end(), [](const Batch& batch) {
+                return batch.instances.empty();
+            });
+            if(batch == this->batches.end()) {
+                batch = this->batches.insert(this->batches.end(), Batch{});
+            }
+            batch->geometry = geometry;
+            batch->first = primitive.get();
+        }
+        batch->instances.push_back(primitive.get());
+    }
+    std::erase_if(this->batches, [](const Batch& batch) {
+        return batch.instances.empty();
+    });
+
+    int numInstances = 0;
+    for(Batch& batch : this->batches) {
+        batch.firstInstance = numInstances;
+        numInstances += batch.instances.size();
+    }
+    if(numInstances == 0) {
+        return;
+    }
+    if(numInstances > this->capacity) {
+        // Grow geometrically, so that adding obstacles one by one rarely reallocates
+        this->capacity = std::max(numInstances, 2 * this->capacity);
+        this->instanceStream.allocate(sizeof(GLfloat) * instanceFloats * this->capacity);
+    }
+    GLfloat* data = static_cast<GLfloat*>(this->instanceStream.beginWrite());
+    for(const Batch& batch : this->batches) {
+        for(const Primitive* instance : batch.instances) {
+            instance->writeInstanceData(data);
+            data += instanceFloats;
+        }
+    }
+    this->instanceStream.endWrite();
+}
+
+void InstancedRenderer::drawBatch(int index) const {
+    const Batch& batch = this->batches[index];
+    const GLsizei stride = sizeof(GLfloat) * instanceFloats;
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->instanceStream.getBuffer()));
+
+    // Point the geometry's instance attributes at the batch's instances; without base instances (GL 4.2),
+    // this is done per batch. The matrices' columns take up consecutive locations.
+    GLintptr offset = this->instanceStream.getOffset() + batch.firstInstance * stride;
+    for(int column = 0; column < 4; column++) {
+        glErrorCheck(glEnableVertexAttribArray(3 + column));
+        glErrorCheck(glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset + 4 * column * sizeof(GLfloat))));
+        glErrorCheck(glVertexAttribDivisor(3 + column, 1));
+    }
+    for(int column = 0; column < 3; column++) {
+        glErrorCheck(glEnableVertexAttribArray(7 + column));
+        glErrorCheck(glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset + (16 + 3 * column) * sizeof(GLfloat))));
+        glErrorCheck(glVertexAttribDivisor(7 + column, 1));
+    }
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    glErrorCheck(glDrawArraysInstanced(GL_TRIANGLES, 0, batch.geometry->numVertices, batch.instances.size()));
+}
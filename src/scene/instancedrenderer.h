@@ -0,0 +1,65 @@
+#ifndef INSTANCEDRENDERER_H
+#define INSTANCEDRENDERER_H
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <GL/glew.h>
+#include "primitives.h"
+#include "utils/streambuffer.h"
+
+// Draws primitives which share both geometry and material as instances of one draw call each. Every frame, the primitives are
+// grouped into batches, and each instance's model and normal matrices are streamed into an instance attribute buffer, from
+// which the instanced shader reads them (at attribute locations 3 to 6, and 7 to 9).
+class InstancedRenderer {
+public:
+    // Groups the given primitives into batches, and uploads their instance data; primitives without
+    // shared geometry are set aside, to be drawn one by one
+    void prepare(std::span<std::unique_ptr<Primitive>> primitives);
+
+    // The primitives set aside by the last prepare
+    std::span<const Primitive* const> getUnbatched() const {
+        return this->unbatched;
+    }
+
+    // The batches of the last prepare, which are drawn through the render queue
+    int getNumBatches() const {
+        return this->batches.size();
+    }
+    const Primitive& getBatchPrimitive(int batch) const {
+        return *this->batches[batch].first;
+    }
+    GLuint getBatchVao(int batch) const {
+        return this->batches[batch].geometry->vao;
+    }
+
+    // Draws the given batch's instances, with the instanced shader, material and texture bound along with the batch's VAO
+    void drawBatch(int batch) const;
+    // Fences the instance data, once all batches have been drawn
+    void fence() {
+        this->instanceStream.fence();
+    }
+
+    // Deletes the instance buffer
+    void free() {
+        this->instanceStream.free();
+        this->capacity = 0;
+    }
+private:
+    // Primitives drawn together, starting at the given instance of the instance buffer
+    struct Batch {
+        const SharedGeometry* geometry;
+        const Primitive* first; // whose material (and texture) the batch is drawn with
+        std::vector<const Primitive*> instances;
+        int firstInstance;
+    };
+    std::vector<Batch> batches;
+    std::vector<const Primitive*> unbatched;
+
+    static const int instanceFloats = 16 + 9; // model and normal matrices
+    StreamBuffer instanceStream;
+    int capacity = 0; // instances the stream buffer has room for
+};
+
+#endif // INSTANCEDRENDERER_H
@@ -1,6 +1,7 @@
 #include "jellocube.h"
 #include "settings.h"
 #include <omp.h>
+#include <complex>
 
 JelloCube::JelloCube(const SceneMaterial& material, int param, glm::vec<3, double> center) : Cube(glm::mat4(1), material, param, false) {
     this->restLen = 1.0f / param;
@@ -12,205 +13,553 @@ JelloCube::JelloCube(const SceneMaterial& material, int param, glm::vec<3, doubl
             }
         }
     }
+    this->fullParam = param;
+    this->initLattice();
 
     std::random_device rd;
     this->gen = std::mt19937(rd());
 }
 
+JelloCube::~JelloCube() {
+    glErrorCheck(glDeleteBuffers(1, &this->nodeVbo));
+    glErrorCheck(glDeleteBuffers(1, &this->attribVbo));
+    glErrorCheck(glDeleteBuffers(1, &this->ebo));
+    glErrorCheck(glDeleteTextures(1, &this->nodeTexture));
+}
+
+// Initializes all bookkeeping derived from the lattice's nodes and resolution
+void JelloCube::initLattice() {
+    this->restLen = 1.0 / this->param1;
+    this->calcMaterialScales();
+    this->allInds.clear();
+    this->surfaceInds.clear();
+    for(int i = 0; i <= this->param1; i++) {
+        for(int j = 0; j <= this->param1; j++) {
+            for(int k = 0; k <= this->param1; k++) {
+                this->allInds.push_back(getInd(i, j, k));
+                if(i == 0 || i == this->param1 || j == 0 || j == this->param1 || k == 0 || k == this->param1) {
+                    this->surfaceInds.push_back(getInd(i, j, k));
+                }
+            }
+        }
+    }
+
+    this->queryX.resize(this->nodes.size());
+    this->queryY.resize(this->nodes.size());
+    this->queryZ.resize(this->nodes.size());
+    this->interX.resize(this->nodes.size());
+    this->interY.resize(this->nodes.size());
+    this->interZ.resize(this->nodes.size());
+    this->interHits.resize(this->nodes.size());
+    this->collisionForces.resize(this->nodes.size());
+    this->contactNormals.assign(this->nodes.size(), glm::vec<3, double>(0));
+    this->contactPoints.resize(this->nodes.size());
+    this->contactVelocities.resize(this->nodes.size());
+    this->activeMask.resize(this->nodes.size());
+    this->interfaceMask.resize(this->nodes.size());
+
+    this->foundInvertedCell = false;
+
+    // Force the contact cache to be rebuilt
+    this->cachedPrimitives.clear();
+    this->cachedPositions = this->nodes;
+    this->calcBounds();
+}
+
+// Scales the nodes' mass and the elastic springs' coefficients, so that the cube's total mass and stiffness (and so its sag
+// and bounce) stay the same at every level of detail. A coarser lattice spreads the mass over fewer nodes, and its longer
+// springs must be stiffer for the material to keep its stiffness (a spring's stiffness over its rest length). Without bend
+// springs, the remaining springs also make up for the bend springs' share of the lattice's stiffness under axial strain:
+// per node, 1 from the structural spring, 2 from the face diagonals and 4/3 from the corner diagonals, against 4 from the
+// bend spring (twice as long).
+void JelloCube::calcMaterialScales() {
+    double fullNodes = std::pow(this->fullParam + 1, 3), numNodes = std::pow(this->param1 + 1, 3);
+    this->massScale = fullNodes / numNodes;
+    this->stiffnessScale = (double) this->fullParam / this->param1;
+    if(this->lod != SimulationLOD::FULL) {
+        this->stiffnessScale *= (1 + 2 + 4.0 / 3 + 4) / (1 + 2 + 4.0 / 3);
+    }
+}
+
 glm::vec<3, double> JelloCube::getStructuralForce(int i, int j, int k) {
     glm::vec<3, double> force(0);
+    double kElastic = settings.kElastic * this->stiffnessScale, dElastic = settings.dElastic * this->stiffnessScale;
     if(i > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k), dElastic);
     }
     if(i < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k), dElastic);
     }
     if(j > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k), dElastic);
     }
     if(j < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k), dElastic);
     }
     if(k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k-1), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k-1), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k-1), dElastic);
     }
     if(k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k+1), settings.kElastic, this->restLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k+1), kElastic, this->restLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k+1), dElastic);
     }
     return force;
 }
 
 glm::vec<3, double> JelloCube::getShearForce(int i, int j, int k) {
     glm::vec<3, double> force(0);
+    double kElastic = settings.kElastic * this->stiffnessScale, dElastic = settings.dElastic * this->stiffnessScale;
     double axisDiagRestLen = sqrt(2) * this->restLen;
     // 4 diagonals along x-axis
     if(j > 0 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k-1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k-1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k-1), dElastic);
     }
     if(j > 0 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k+1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j-1, k+1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-1, k+1), dElastic);
     }
     if(j < this->param1 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k-1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k-1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k-1), dElastic);
     }
     if(j < this->param1 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k+1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j+1, k+1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+1, k+1), dElastic);
     }
     // 4 diagonals along y-axis
     if(i > 0 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k-1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k-1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k-1), dElastic);
     }
     if(i > 0 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k+1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j, k+1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j, k+1), dElastic);
     }
     if(i < this->param1 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k-1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k-1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k-1), dElastic);
     }
     if(i < this->param1 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k+1), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j, k+1), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j, k+1), dElastic);
     }
     // 4 diagonals along z-axis
     if(i > 0 && j > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k), dElastic);
     }
     if(i > 0 && j < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k), dElastic);
     }
     if(i < this->param1 && j > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k), dElastic);
     }
     if(i < this->param1 && j < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k), settings.kElastic, axisDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k), kElastic, axisDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k), dElastic);
     }
     // 8 corners
     double cornerDiagRestLen = sqrt(3) * this->restLen;
     if(i > 0 && j > 0 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k-1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k-1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k-1), dElastic);
     }
     if(i > 0 && j > 0 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k+1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j-1, k+1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j-1, k+1), dElastic);
     }
     if(i > 0 && j < this->param1 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k-1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k-1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k-1), dElastic);
     }
     if(i > 0 && j < this->param1 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k+1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-1, j+1, k+1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-1, j+1, k+1), dElastic);
     }
     if(i < this->param1 && j > 0 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k-1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k-1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k-1), dElastic);
     }
     if(i < this->param1 && j > 0 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k+1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j-1, k+1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j-1, k+1), dElastic);
     }
     if(i < this->param1 && j < this->param1 && k > 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k-1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k-1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k-1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k-1), dElastic);
     }
     if(i < this->param1 && j < this->param1 && k < this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k+1), settings.kElastic, cornerDiagRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k+1), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+1, j+1, k+1), kElastic, cornerDiagRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+1, j+1, k+1), dElastic);
     }
     return force;
 }
 
 glm::vec<3, double> JelloCube::getBendForce(int i, int j, int k) {
     glm::vec<3, double> force(0);
+    double kElastic = settings.kElastic * this->stiffnessScale, dElastic = settings.dElastic * this->stiffnessScale;
     double bendRestLen = 2 * this->restLen;
     if(i-2 >= 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i-2, j, k), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i-2, j, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i-2, j, k), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i-2, j, k), dElastic);
     }
     if(i+2 <= this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i+2, j, k), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i+2, j, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i+2, j, k), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i+2, j, k), dElastic);
     }
     if(j-2 >= 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j-2, k), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-2, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j-2, k), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j-2, k), dElastic);
     }
     if(j+2 <= this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j+2, k), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+2, k), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j+2, k), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j+2, k), dElastic);
     }
     if(k-2 >= 0) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k-2), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k-2), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k-2), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k-2), dElastic);
     }
     if(k+2 <= this->param1) {
-        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k+2), settings.kElastic, bendRestLen);
-        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k+2), settings.dElastic);
+        force += this->hooksForce(getInd(i, j, k), getInd(i, j, k+2), kElastic, bendRestLen);
+        force += this->dampeningForce(getInd(i, j, k), getInd(i, j, k+2), dElastic);
     }
     return force;
 }
 
-glm::vec<3, double> JelloCube::getCollisionForce(int i, int j, int k, std::span<std::unique_ptr<Primitive>>& primitives) {
-    glm::vec<3, double> force(0);
-    glm::vec<3, double> pos = this->nodes[getInd(i, j, k)];
-    glm::vec<3, double> vel = this->velocities[getInd(i, j, k)];
-    glm::vec<3, double> objVel = glm::vec<3, double>(0);
-    if(pos.x > settings.bounds) {
-        glm::vec<3, double> collisionPoint(settings.bounds, pos.y, pos.z);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
-    }
-    if(pos.x < -settings.bounds) {
-        glm::vec<3, double> collisionPoint(-settings.bounds, pos.y, pos.z);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
-    }
-    if(pos.y > settings.bounds) {
-        glm::vec<3, double> collisionPoint(pos.x, settings.bounds, pos.z);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
-    }
-    if(pos.y < -settings.bounds) {
-        glm::vec<3, double> collisionPoint(pos.x, -settings.bounds, pos.z);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
-    }
-    if(pos.z > settings.bounds) {
-        glm::vec<3, double> collisionPoint(pos.x, pos.y, settings.bounds);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
-    }
-    if(pos.z < -settings.bounds) {
-        glm::vec<3, double> collisionPoint(pos.x, pos.y, -settings.bounds);
-        force += this->hooksForce(pos, collisionPoint, settings.kCollision, 0);
-        force += this->dampeningForce(pos, collisionPoint, vel, objVel, settings.dCollision);
+// Finds the contacts of the given candidate nodes with the walls of the scene's bounding box and the given primitives,
+// testing each primitive against its own given candidates. Each primitive is queried once for its whole batch of
+// nodes (primitive-major), so that the intersection tests run as vectorized loops.
+void JelloCube::findContacts(std::vector<glm::vec<3, double>>& positions,
+                             std::span<std::unique_ptr<Primitive>>& primitives,
+                             std::vector<int>& candidates,
+                             std::vector<std::vector<int>>& contactCandidates) {
+    this->contacts.clear();
+    double bounds = settings.bounds;
+    for(int ind : candidates) {
+        glm::vec<3, double>& pos = positions[ind];
+        for(int axis = 0; axis < 3; axis++) {
+            if(std::abs(pos[axis]) > bounds) {
+                glm::vec<3, double> collisionPoint = pos;
+                collisionPoint[axis] = pos[axis] > 0 ? bounds : -bounds;
+                this->contacts.push_back({ind, collisionPoint, glm::vec<3, double>(0)});
+            }
+        }
+    }
+
+    for(int p = 0; p < primitives.size(); p++) {
+        std::vector<int>& primCandidates = contactCandidates[p];
+        size_t numQueries = primCandidates.size();
+        if(numQueries == 0) {
+            continue;
+        }
+
+        for(int n = 0; n < numQueries; n++) {
+            int ind = primCandidates[n];
+            this->queryX[n] = positions[ind].x;
+            this->queryY[n] = positions[ind].y;
+            this->queryZ[n] = positions[ind].z;
+        }
+        PointBatch points = {
+            std::span<const double>(this->queryX.data(), numQueries),
+            std::span<const double>(this->queryY.data(), numQueries),
+            std::span<const double>(this->queryZ.data(), numQueries)
+        };
+        IntersectionBatch inters = {
+            std::span<double>(this->interX.data(), numQueries),
+            std::span<double>(this->interY.data(), numQueries),
+            std::span<double>(this->interZ.data(), numQueries),
+            std::span<uint8_t>(this->interHits.data(), numQueries)
+        };
+        primitives[p]->findIntersectionPoints(points, inters);
+
+        for(int n = 0; n < numQueries; n++) {
+            int ind = primCandidates[n];
+            glm::vec<3, double> interPoint(this->interX[n], this->interY[n], this->interZ[n]);
+            // A node lying exactly on the surface is not in contact, and the contact's normal would be undefined
+            if(this->interHits[n] && interPoint != positions[ind]) {
+                this->contacts.push_back({ind, interPoint, primitives[p]->getVelocity(interPoint)});
+            }
+        }
+    }
+}
+
+// Computes the collision forces on all nodes, due to the scene bounds and the given primitives.
+// Only the surface nodes are checked, unless the interior fallback is enabled, and each primitive
+// is only tested against its cached candidate nodes.
+void JelloCube::computeCollisionForces(std::vector<glm::vec<3, double>>& positions,
+                                       std::vector<glm::vec<3, double>>& velocities,
+                                       std::span<std::unique_ptr<Primitive>>& primitives) {
+    this->computeCollisionForces(positions, velocities, primitives,
+                                 this->checkInterior ? this->allInds : this->surfaceInds, this->contactCandidates);
+}
+
+// Computes the collision forces on the given candidate nodes, testing each primitive against its own given candidates.
+// These are only penalty forces; constraint-based contacts are instead resolved after each step.
+void JelloCube::computeCollisionForces(std::vector<glm::vec<3, double>>& positions,
+                                       std::vector<glm::vec<3, double>>& velocities,
+                                       std::span<std::unique_ptr<Primitive>>& primitives,
+                                       std::vector<int>& candidates,
+                                       std::vector<std::vector<int>>& contactCandidates) {
+    std::fill(this->collisionForces.begin(), this->collisionForces.end(), glm::vec<3, double>(0));
+    if(settings.contactModel != ContactModel::PENALTY) {
+        return;
+    }
+
+    // Collision springs scale with the nodes' mass, so that they push nodes out at the same rate at any resolution
+    double kCollision = settings.kCollision * this->massScale, dCollision = settings.dCollision * this->massScale;
+    this->findContacts(positions, primitives, candidates, contactCandidates);
+    for(Contact& contact : this->contacts) {
+        this->collisionForces[contact.ind] += this->hooksForce(positions[contact.ind], contact.point, kCollision, 0);
+        this->collisionForces[contact.ind] += this->dampeningForce(positions[contact.ind], contact.point, velocities[contact.ind], contact.velocity, dCollision);
     }
+}
+
+// Applies Coulomb friction to the tangential component of a node's velocity or acceleration, given the size of the normal
+// component being removed by a contact: the tangential component is removed entirely within the static friction cone,
+// and otherwise reduced by the dynamic friction
+static glm::vec<3, double> applyFriction(glm::vec<3, double> tangent, double normal) {
+    double tangentLen = glm::length(tangent);
+    if(tangentLen <= settings.staticFriction * normal) {
+        return glm::vec<3, double>(0);
+    }
+    return tangent * (1 - std::min(settings.dynamicFriction * normal / tangentLen, 1.0));
+}
+
+// Resolves contacts after a step: each penetrating node is projected back onto the surface, its velocity into the surface
+// (relative to the surface's own velocity) is removed, and friction is applied with the resulting normal impulse. Contacts of the same node are resolved in sequence
+// (Gauss-Seidel). Nodes stay in contact, and keep their contact normal, for as long as they rest on the surface.
+void JelloCube::resolveContacts(std::span<std::unique_ptr<Primitive>>& primitives) {
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        if(this->contactNormals[ind] != glm::vec<3, double>(0) &&
+           glm::dot(this->nodes[ind] - this->contactPoints[ind], this->contactNormals[ind]) > this->contactSkin) {
+            this->contactNormals[ind] = glm::vec<3, double>(0); // the node has left the surface
+        }
+    }
+
+    this->findContacts(this->nodes, primitives, this->checkInterior ? this->allInds : this->surfaceInds, this->contactCandidates);
+    for(Contact& contact : this->contacts) {
+        glm::vec<3, double> normal = contact.point - this->nodes[contact.ind];
+        double depth = glm::length(normal);
+        if(depth == 0) {
+            continue; // already resolved by a previous contact of the same node
+        }
+        this->nodes[contact.ind] = contact.point;
+        this->contactPoints[contact.ind] = contact.point;
+        this->contactNormals[contact.ind] = normal / depth;
+        this->contactVelocities[contact.ind] = contact.velocity;
+    }
+
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        glm::vec<3, double>& normal = this->contactNormals[ind];
+        glm::vec<3, double> relVel = this->velocities[ind] - this->contactVelocities[ind];
+        double normalVel = glm::dot(relVel, normal);
+        if(normalVel < 0) {
+            this->velocities[ind] = this->contactVelocities[ind] + applyFriction(relVel - normalVel * normal, -normalVel);
+        }
+    }
+}
+
+// Applies the contact reactions to the accelerations of the given nodes in contact: the acceleration into the surface is
+// removed, and friction is applied with the resulting normal reaction, so that nodes resting on a surface stay at rest
+void JelloCube::constrainAcceleration(std::vector<glm::vec<3, double>>& acc, std::vector<int>& inds) {
+    for(int ind : inds) {
+        glm::vec<3, double>& normal = this->contactNormals[ind];
+        double normalAcc = glm::dot(acc[ind], normal);
+        if(normalAcc < 0) {
+            acc[ind] = applyFriction(acc[ind] - normalAcc * normal, -normalAcc);
+        }
+    }
+}
+
+// Continuous collision detection: every candidate node that moved further than the threshold during the step, relative to the
+// walls of the scene's bounds or to a primitive, is swept against it from its position at the start of the step, and stopped at
+// its earliest time of impact. A moving primitive is swept against in its pose at the end of the step, starting from where the
+// node was relative to it. This keeps fast nodes (or obstacles) from tunneling through thin obstacles (or the cube), or from ending
+// the step so deep inside one that the contact response explodes. Under constraint-based contacts, the node is then held on the
+// surface by resolveContacts; otherwise, its velocity into the surface is removed here.
+void JelloCube::sweepContacts(double dt, std::span<std::unique_ptr<Primitive>>& primitives) {
+    std::vector<int>& candidates = this->checkInterior ? this->allInds : this->surfaceInds;
+    double thresholdSq = this->ccdDisplacement * this->ccdDisplacement;
+    glm::vec<3, double> sweptMin(std::numeric_limits<double>::max()), sweptMax(-std::numeric_limits<double>::max());
+    bool anyFast = false;
+    for(int ind : candidates) {
+        glm::vec<3, double> move = this->nodes[ind] - this->sweepStart[ind];
+        anyFast = anyFast || glm::dot(move, move) > thresholdSq;
+        sweptMin = glm::min(sweptMin, glm::min(this->sweepStart[ind], this->nodes[ind]));
+        sweptMax = glm::max(sweptMax, glm::max(this->sweepStart[ind], this->nodes[ind]));
+    }
+
+    // Broad phase: only the primitives whose bounding spheres, swept along their own motion, overlap the box swept out by the
+    // candidate nodes are kept
+    this->sweptPrimitives.clear();
     for(std::unique_ptr<Primitive>& primitive : primitives) {
-        std::optional<glm::vec3> interPoint = primitive->findIntersectionPoint(pos);
-        if(interPoint) {
-            glm::vec<3, double> doubleInterPoint(*interPoint);
-            force += this->hooksForce(pos, doubleInterPoint, settings.kCollision, 0);
-            force += this->dampeningForce(pos, doubleInterPoint, vel, objVel, settings.dCollision);
+        glm::vec<3, double> center = primitive->getBoundsCenter();
+        glm::vec<3, double> toBox = glm::clamp(center, sweptMin, sweptMax) - center;
+        double radius = primitive->getBoundsRadius() + glm::length(primitive->getBoundsDisplacement());
+        if(glm::dot(toBox, toBox) <= radius * radius) {
+            this->sweptPrimitives.push_back(primitive.get());
+            anyFast = anyFast || primitive->isMoving();
         }
     }
-    return force;
+    if(!anyFast) {
+        return;
+    }
+
+    double bounds = settings.bounds;
+    for(int ind : candidates) {
+        glm::vec<3, double> start = this->sweepStart[ind];
+        glm::vec<3, double>& end = this->nodes[ind];
+        glm::vec<3, double> move = end - start;
+        double impactTime = std::numeric_limits<double>::max();
+        glm::vec<3, double> impactStart, impactNormal, impactVelocity;
+
+        // Walls are static, so only a node fast enough to tunnel on its own can pass through one
+        if(glm::dot(move, move) > thresholdSq) {
+            for(int axis = 0; axis < 3; axis++) {
+                if(std::abs(start[axis]) <= bounds && std::abs(end[axis]) > bounds) {
+                    double wall = end[axis] > 0 ? bounds : -bounds;
+                    double time = (wall - start[axis]) / move[axis];
+                    if(time < impactTime) {
+                        impactTime = time;
+                        impactStart = start;
+                        impactNormal = glm::vec<3, double>(0);
+                        impactNormal[axis] = wall > 0 ? -1 : 1; // the walls face inwards
+                        impactVelocity = glm::vec<3, double>(0);
+                    }
+                }
+            }
+        }
+
+        for(Primitive* primitive : this->sweptPrimitives) {
+            glm::vec<3, double> objVel = primitive->getVelocity(end);
+            glm::vec<3, double> relStart = start + objVel * dt;
+            glm::vec<3, double> relMove = end - relStart;
+            double relMoveLenSq = glm::dot(relMove, relMove);
+            if(relMoveLenSq <= thresholdSq) {
+                continue;
+            }
+
+            // Skip the narrow phase unless the node's path passes through the primitive's bounding sphere
+            glm::vec<3, double> toCenter = glm::vec<3, double>(primitive->getBoundsCenter()) - relStart;
+            double closest = std::clamp(glm::dot(toCenter, relMove) / relMoveLenSq, 0.0, 1.0);
+            glm::vec<3, double> offset = toCenter - closest * relMove;
+            double radius = primitive->getBoundsRadius();
+            if(glm::dot(offset, offset) > radius * radius) {
+                continue;
+            }
+
+            std::optional<Impact> impact = primitive->findTimeOfImpact(relStart, end);
+            if(impact && impact->time < impactTime) {
+                impactTime = impact->time;
+                impactStart = relStart;
+                impactNormal = impact->normal;
+                impactVelocity = objVel;
+            }
+        }
+        if(impactTime > 1) {
+            continue;
+        }
+
+        end = impactStart + impactTime * (end - impactStart);
+        if(settings.contactModel == ContactModel::CONSTRAINT) {
+            this->contactNormals[ind] = impactNormal;
+            this->contactPoints[ind] = end;
+            this->contactVelocities[ind] = impactVelocity;
+        } else {
+            glm::vec<3, double> relVel = this->velocities[ind] - impactVelocity;
+            double normalVel = glm::dot(relVel, impactNormal);
+            if(normalVel < 0) {
+                this->velocities[ind] -= normalVel * impactNormal;
+            }
+        }
+    }
+}
+
+// Refreshes the broad-phase contact cache if it has gone stale; this happens every few steps,
+// or immediately if the primitives or candidate nodes have changed, or if any node may end the
+// coming step (of dt seconds) far enough from where it was at the last refresh that it may have
+// entered a new primitive. Otherwise, only the candidates of primitives that have moved too far
+// themselves are refitted.
+void JelloCube::updateContactCache(double dt, std::span<std::unique_ptr<Primitive>>& primitives) {
+    std::vector<int>& candidates = this->checkInterior ? this->allInds : this->surfaceInds;
+    bool stale = ++this->stepsSinceRefresh >= this->contactRefreshSteps ||
+                 this->cachedInterior != this->checkInterior ||
+                 this->cachedPrimitives.size() != primitives.size();
+    for(int p = 0; !stale && p < primitives.size(); p++) {
+        stale = this->cachedPrimitives[p] != primitives[p].get();
+    }
+    double maxNodeMoveSq = 0, maxSpeedSq = 0;
+    for(int ind : candidates) {
+        glm::vec<3, double> move = this->nodes[ind] - this->cachedPositions[ind];
+        maxNodeMoveSq = std::max(maxNodeMoveSq, glm::dot(move, move));
+        maxSpeedSq = std::max(maxSpeedSq, glm::dot(this->velocities[ind], this->velocities[ind]));
+    }
+    // Nodes and primitives may only close in by half the cache's margin, counting the nodes' motion since the last refresh and
+    // over the coming step at their current velocities; the other half is left as slack for the velocities' change during the step
+    double stepMove = dt * std::sqrt(maxSpeedSq);
+    double nodeMove = std::sqrt(maxNodeMoveSq) + stepMove;
+    double maxMove = 0.5 * this->cachedMargin;
+    stale = stale || nodeMove > maxMove;
+
+    if(!stale) {
+        for(int p = 0; p < primitives.size(); p++) {
+            // A primitive's bounding sphere may also have grown, under a scaling animation
+            double primitiveMove = glm::length(glm::vec<3, double>(primitives[p]->getBoundsCenter()) - this->cachedCenters[p]) +
+                                   std::max(primitives[p]->getBoundsRadius() - this->cachedRadii[p], 0.0);
+            if(nodeMove + primitiveMove > maxMove) {
+                this->refitContactCandidates(p, *primitives[p], candidates);
+            }
+        }
+        return;
+    }
+
+    // Nodes fast enough to cover much of the margin in a single step get a margin wide enough for the step
+    this->cachedMargin = std::max(this->contactMargin, 2 * stepMove);
+    this->contactCandidates.resize(primitives.size());
+    this->cachedPrimitives.resize(primitives.size());
+    this->cachedCenters.resize(primitives.size());
+    this->cachedRadii.resize(primitives.size());
+    this->cachedPositions = this->nodes;
+    for(int p = 0; p < primitives.size(); p++) {
+        this->refitContactCandidates(p, *primitives[p], candidates);
+        this->cachedPrimitives[p] = primitives[p].get();
+    }
+    this->cachedInterior = this->checkInterior;
+    this->stepsSinceRefresh = 0;
+}
+
+// Refits the contact cache's candidates for the p-th primitive, from the nodes' positions as of the last refresh
+// (rather than their current positions), so that their motion since then is still bounded by the staleness checks
+void JelloCube::refitContactCandidates(int p, const Primitive& primitive, std::vector<int>& candidates) {
+    glm::vec<3, double> center = primitive.getBoundsCenter();
+    double radius = primitive.getBoundsRadius() + this->cachedMargin;
+    this->contactCandidates[p].clear();
+    for(int ind : candidates) {
+        glm::vec<3, double> toCenter = this->cachedPositions[ind] - center;
+        if(glm::dot(toCenter, toCenter) <= radius * radius) {
+            this->contactCandidates[p].push_back(ind);
+        }
+    }
+    this->cachedCenters[p] = center;
+    this->cachedRadii[p] = primitive.getBoundsRadius();
+}
+
+// Checks whether the cell with the given corner node (its lowest in every axis) has been turned inside out,
+// in which case interior nodes may have been pushed past the surface shell
+bool JelloCube::isCellInverted(int i, int j, int k) {
+    glm::vec<3, double>& corner = this->nodes[getInd(i, j, k)];
+    glm::vec<3, double> edgeX = this->nodes[getInd(i+1, j, k)] - corner;
+    glm::vec<3, double> edgeY = this->nodes[getInd(i, j+1, k)] - corner;
+    glm::vec<3, double> edgeZ = this->nodes[getInd(i, j, k+1)] - corner;
+    return glm::dot(glm::cross(edgeX, edgeY), edgeZ) < 0;
 }
 
 // Computes the total acceleration for all nodes given their current positions/velocities
@@ -218,36 +567,250 @@ void JelloCube::computeAcceleration(std::vector<glm::vec<3, double>>& positions,
                                     std::vector<glm::vec<3, double>>& velocities,
                                     std::vector<glm::vec<3, double>>& acc,
                                     std::span<std::unique_ptr<Primitive>>& primitives) {
-    // #pragma omp parallel for collapse(3)
+    // The spring forces read the lattice's own state, so swap the given state in while evaluating them
+    bool swapState = &positions != &this->nodes;
+    if(swapState) {
+        std::swap(this->nodes, positions);
+        std::swap(this->velocities, velocities);
+    }
+
+    this->computeCollisionForces(this->nodes, this->velocities, primitives);
+    // The lattice's own state (evaluated once at the start of every step) has its cells checked for inversion,
+    // while their corner nodes are at hand for the spring forces anyway
+    bool checkCells = !swapState, inverted = false;
+    // #pragma omp parallel for collapse(3) reduction(||: inverted)
     for(int i = 0; i <= this->param1; i++) {
         for(int j = 0; j <= this->param1; j++) {
             for(int k = 0; k <= this->param1; k++) {
-                int ind = this->getInd(i, j, k);
-                acc[ind] = glm::vec<3, double>(0);
-                acc[ind] += this->getStructuralForce(i, j, k);
-                acc[ind] += this->getShearForce(i, j, k);
-                acc[ind] += this->getBendForce(i, j, k);
-                acc[ind] += this->getCollisionForce(i, j, k, primitives);
-                acc[ind] += glm::vec<3, double>(0, -settings.gravity, 0);
-
-                acc[ind] /= settings.mass;
+                acc[this->getInd(i, j, k)] = this->getAcceleration(i, j, k);
+                if(checkCells && i < this->param1 && j < this->param1 && k < this->param1 && this->isCellInverted(i, j, k)) {
+                    inverted = true;
+                }
+            }
+        }
+    }
+    this->foundInvertedCell = this->foundInvertedCell || inverted;
+    if(settings.contactModel == ContactModel::CONSTRAINT) {
+        this->constrainAcceleration(acc, this->allInds);
+    }
+
+    if(swapState) {
+        std::swap(this->nodes, positions);
+        std::swap(this->velocities, velocities);
+    }
+}
+
+// Computes the total acceleration of a single node, given the current collision forces
+glm::vec<3, double> JelloCube::getAcceleration(int i, int j, int k) {
+    glm::vec<3, double> acc(0);
+    acc += this->getStructuralForce(i, j, k);
+    acc += this->getShearForce(i, j, k);
+    if(this->lod == SimulationLOD::FULL) {
+        acc += this->getBendForce(i, j, k);
+    }
+    acc += this->collisionForces[this->getInd(i, j, k)];
+    acc += glm::vec<3, double>(0, -settings.gravity * this->massScale, 0);
+    return acc / (settings.mass * this->massScale);
+}
+
+// Finds the active nodes for a multirate step: those in contact at the start of the step (given by the current
+// collision forces, or the resting contacts under constraint-based contacts) or at the end of a tentative coarse
+// step (given by the positions in this->nodes), along with their neighbours. Also finds the passive nodes within
+// reach of an active node's springs, which form the interface.
+void JelloCube::findActiveNodes(std::span<std::unique_ptr<Primitive>>& primitives) {
+    std::vector<int>& candidates = this->checkInterior ? this->allInds : this->surfaceInds;
+    std::vector<uint8_t> inContact(this->nodes.size(), 0);
+    for(int ind : candidates) {
+        inContact[ind] = this->collisionForces[ind] != glm::vec<3, double>(0) || this->contactNormals[ind] != glm::vec<3, double>(0);
+    }
+    this->findContacts(this->nodes, primitives, candidates, this->contactCandidates);
+    for(Contact& contact : this->contacts) {
+        inContact[contact.ind] = 1;
+    }
+
+    // Marks all nodes within the given (Chebyshev) distance of a node
+    auto markNeighbours = [this](std::vector<uint8_t>& mask, int ind, int dist) {
+        int n = this->param1 + 1;
+        int i = ind / (n * n), j = (ind / n) % n, k = ind % n;
+        for(int ni = std::max(i - dist, 0); ni <= std::min(i + dist, this->param1); ni++) {
+            for(int nj = std::max(j - dist, 0); nj <= std::min(j + dist, this->param1); nj++) {
+                for(int nk = std::max(k - dist, 0); nk <= std::min(k + dist, this->param1); nk++) {
+                    mask[getInd(ni, nj, nk)] = 1;
+                }
+            }
+        }
+    };
+    std::fill(this->activeMask.begin(), this->activeMask.end(), 0);
+    std::fill(this->interfaceMask.begin(), this->interfaceMask.end(), 0);
+    for(int ind : candidates) {
+        if(inContact[ind]) {
+            markNeighbours(this->activeMask, ind, 1);
+        }
+    }
+    this->activeInds.clear();
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        if(this->activeMask[ind]) {
+            this->activeInds.push_back(ind);
+            // Bend springs reach two nodes away
+            markNeighbours(this->interfaceMask, ind, this->lod == SimulationLOD::FULL ? 2 : 1);
+        }
+    }
+    this->interfaceInds.clear();
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        if(this->interfaceMask[ind] && !this->activeMask[ind]) {
+            this->interfaceInds.push_back(ind);
+        }
+    }
+
+    // Only active nodes are tested for collisions during substeps
+    this->activeCandidates.clear();
+    for(int ind : candidates) {
+        if(this->activeMask[ind]) {
+            this->activeCandidates.push_back(ind);
+        }
+    }
+    this->activeContactCandidates.resize(this->contactCandidates.size());
+    for(int p = 0; p < this->contactCandidates.size(); p++) {
+        this->activeContactCandidates[p].clear();
+        for(int ind : this->contactCandidates[p]) {
+            if(this->activeMask[ind]) {
+                this->activeContactCandidates[p].push_back(ind);
             }
         }
     }
 }
 
-// Updates the colors, as well as positions and velocities of the jello cube's nodes using RK4 integration
-void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives) {
+// Advances all nodes by one step of symplectic Euler integration, in which only the nodes near contacts
+// (which feel the stiff collision springs) take several substeps, while the rest of the lattice takes a
+// single coarse step. During substeps, the passive nodes at the interface move linearly between their
+// positions at the start and end of the coarse step, so that the active nodes see them move consistently.
+void JelloCube::multirateStep(double dt, std::vector<glm::vec<3, double>>& acc,
+                              std::span<std::unique_ptr<Primitive>>& primitives) {
+    // Tentative coarse step for all nodes
+    this->computeAcceleration(this->nodes, this->velocities, acc, primitives);
+    this->stepStartPos = this->nodes;
+    this->stepStartVel = this->velocities;
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        this->velocities[ind] += dt * acc[ind];
+        this->nodes[ind] += dt * this->velocities[ind];
+    }
+    this->stepEndPos = this->nodes;
+
+    this->findActiveNodes(primitives);
+    if(this->activeInds.empty()) {
+        return;
+    }
+
+    // Active nodes are rewound, then substep
+    for(int ind : this->activeInds) {
+        this->nodes[ind] = this->stepStartPos[ind];
+        this->velocities[ind] = this->stepStartVel[ind];
+    }
+    int substeps = std::max((int) settings.contactSubsteps, 1);
+    double h = dt / substeps;
+    int n = this->param1 + 1;
+    for(int s = 0; s < substeps; s++) {
+        double t = (double) s / substeps;
+        for(int ind : this->interfaceInds) {
+            this->nodes[ind] = this->stepStartPos[ind] + t * (this->stepEndPos[ind] - this->stepStartPos[ind]);
+        }
+
+        this->computeCollisionForces(this->nodes, this->velocities, primitives, this->activeCandidates, this->activeContactCandidates);
+        for(int ind : this->activeInds) {
+            acc[ind] = this->getAcceleration(ind / (n * n), (ind / n) % n, ind % n);
+        }
+        if(settings.contactModel == ContactModel::CONSTRAINT) {
+            this->constrainAcceleration(acc, this->activeInds);
+        }
+        for(int ind : this->activeInds) {
+            this->velocities[ind] += h * acc[ind];
+            this->nodes[ind] += h * this->velocities[ind];
+        }
+    }
+    for(int ind : this->interfaceInds) {
+        this->nodes[ind] = this->stepEndPos[ind];
+    }
+}
+
+// Returns the timestep (in seconds) the cube asks to be advanced by: the fixed dt, or its estimated stable timestep.
+// A sleeping cube's lattice doesn't change, so it keeps the estimate it fell asleep with until the settings change.
+double JelloCube::getTimestep() {
+    if(!settings.autoTimestep) {
+        return settings.dt / 1000.0;
+    }
+    if(!this->asleep || settings != this->sleepSettings) {
+        this->timestep = settings.timestepSafety * this->getStableTimestep();
+    }
+    return this->timestep;
+}
+
+// Updates the colors, as well as positions and velocities of the jello cube's nodes by dt (in seconds), using the current integrator
+void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives, double dt) {
     this->material.cDiffuse.a = settings.transparentCube ? 0.5 : 1;
+    if(this->asleep) {
+        if(settings == this->sleepSettings) {
+            return;
+        }
+        this->wake();
+    }
+
+    std::vector<glm::vec<3, double>> acc(this->nodes.size());
 
+    // Advance by dt, split into smaller steps while recovering from an explosion. If any step is unhealthy,
+    // roll back to the state at the start of the update and retry with steps of half the size.
+    this->lastGoodNodes = this->nodes;
+    this->lastGoodVelocities = this->velocities;
+    for(int attempt = 0; ; attempt++) {
+        int steps = (int) std::ceil(1 / this->stepScale - 1e-9);
+        bool healthy = true;
+        for(int s = 0; healthy && s < steps; s++) {
+            double energy = this->getKineticEnergy();
+            this->step(dt / steps, acc, primitives);
+            healthy = this->isHealthy(energy);
+        }
+        if(healthy) {
+            // Ramp back up towards the full step
+            this->stepScale = std::min(this->stepScale * this->stepRamp, 1.0);
+            break;
+        }
+
+        this->nodes = this->lastGoodNodes;
+        this->velocities = this->lastGoodVelocities;
+        this->cachedPrimitives.clear(); // the contact cache may hold the failed state
+        std::fill(this->contactNormals.begin(), this->contactNormals.end(), glm::vec<3, double>(0));
+        if(attempt == this->maxStepRetries) {
+            // Give up on this update, and stop the cube in its last good state instead; the cube is then at rest, so
+            // the next update starts over from the full step, rather than taking many tiny steps for a long hitch
+            std::fill(this->velocities.begin(), this->velocities.end(), glm::vec<3, double>(0));
+            std::fill(acc.begin(), acc.end(), glm::vec<3, double>(0));
+            this->stepScale = 1;
+            break;
+        }
+        this->stepScale *= 0.5;
+    }
+
+    this->calcBounds();
+    this->updateSleepState(acc);
+
+    // Calculate and upload new vertex data
+    this->uploadVertexData();
+}
+
+// Advances the positions and velocities of the jello cube's nodes by a single step of the current integrator
+void JelloCube::step(double dt, std::vector<glm::vec<3, double>>& acc, std::span<std::unique_ptr<Primitive>>& primitives) {
     std::vector<glm::vec<3, double>> tmpPos(this->nodes.size()), tmpVels(this->nodes.size());
     std::vector<glm::vec<3, double>> F1pos(this->nodes.size()), F1vel(this->nodes.size());
     std::vector<glm::vec<3, double>> F2pos(this->nodes.size()), F2vel(this->nodes.size());
     std::vector<glm::vec<3, double>> F3pos(this->nodes.size()), F3vel(this->nodes.size());
     std::vector<glm::vec<3, double>> F4pos(this->nodes.size()), F4vel(this->nodes.size());
-    std::vector<glm::vec<3, double>> acc(this->nodes.size());
 
-    double dt = settings.dt / 1000.0;
+    // Inverted cells are found while evaluating the previous step's accelerations, so the fallback lags them by a step
+    this->checkInterior = this->foundInvertedCell;
+    this->foundInvertedCell = false;
+    this->updateContactCache(dt, primitives);
+    if(settings.continuousCollisions) {
+        this->sweepStart = this->nodes;
+    }
     if(settings.integrator == Integrator::EULER) {
         this->computeAcceleration(this->nodes, this->velocities, acc, primitives);
         // #pragma omp parallel for collapse(3)
@@ -276,7 +839,7 @@ void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives) {
             }
         }
 
-        this->computeAcceleration(this->nodes, this->velocities, acc, primitives);
+        this->computeAcceleration(tmpPos, tmpVels, acc, primitives);
         // #pragma omp parallel for collapse(3)
         for(int i = 0; i <= this->param1; i++) {
             for(int j = 0; j <= this->param1; j++) {
@@ -291,7 +854,7 @@ void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives) {
             }
         }
 
-        this->computeAcceleration(this->nodes, this->velocities, acc, primitives);
+        this->computeAcceleration(tmpPos, tmpVels, acc, primitives);
         // #pragma omp parallel for collapse(3)
         for(int i = 0; i <= this->param1; i++) {
             for(int j = 0; j <= this->param1; j++) {
@@ -306,7 +869,7 @@ void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives) {
             }
         }
 
-        this->computeAcceleration(this->nodes, this->velocities, acc, primitives);
+        this->computeAcceleration(tmpPos, tmpVels, acc, primitives);
         // #pragma omp parallel for collapse(3)
         for(int i = 0; i <= this->param1; i++) {
             for(int j = 0; j <= this->param1; j++) {
@@ -322,17 +885,302 @@ void JelloCube::update(std::span<std::unique_ptr<Primitive>>& primitives) {
                 }
             }
         }
+    } else if(settings.integrator == Integrator::MULTIRATE) {
+        this->multirateStep(dt, acc, primitives);
+        for(glm::vec<3, double>& node : this->nodes) {
+            node = glm::clamp(node, glm::vec<3, double>(-this->maxPos), glm::vec<3, double>(this->maxPos));
+        }
     }
 
-    // Calculate new vertex data
-    this->calcVertexData();
-    // Associate new data with VBO
-    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->vbo));
-    glErrorCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(GLdouble) * this->vertexData.size(), this->vertexData.data(), GL_STATIC_DRAW));
-    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    // Strain limiting moves nodes, so it runs before the contact passes, which then get the final say on where nodes may be
+    if(settings.strainLimiting) {
+        this->limitStrain(dt);
+    }
+    if(settings.continuousCollisions) {
+        this->sweepContacts(dt, primitives);
+    }
+    if(settings.contactModel == ContactModel::CONSTRAINT) {
+        this->resolveContacts(primitives);
+    }
+}
+
+// Lattice offsets to the other end of each spring of a node: the 6 structural and 20 shear springs, then the 6 bend springs
+static const glm::ivec3 springOffsets[] = {
+    {-1, -1, -1}, {-1, -1, 0}, {-1, -1, 1}, {-1, 0, -1}, {-1, 0, 0}, {-1, 0, 1}, {-1, 1, -1}, {-1, 1, 0}, {-1, 1, 1},
+    {0, -1, -1}, {0, -1, 0}, {0, -1, 1}, {0, 0, -1}, {0, 0, 1}, {0, 1, -1}, {0, 1, 0}, {0, 1, 1},
+    {1, -1, -1}, {1, -1, 0}, {1, -1, 1}, {1, 0, -1}, {1, 0, 0}, {1, 0, 1}, {1, 1, -1}, {1, 1, 0}, {1, 1, 1},
+    {-2, 0, 0}, {2, 0, 0}, {0, -2, 0}, {0, 2, 0}, {0, 0, -2}, {0, 0, 2}
+};
+
+// Clamps every spring's length to [minStretch, maxStretch] times its rest length, by Jacobi iterations: each node gathers
+// the corrections (half of each violating spring's excess) from all of its springs, and moves by their average, so that all
+// nodes can be updated in parallel. Velocities are then corrected by the total displacement, to stay consistent.
+void JelloCube::limitStrain(double dt) {
+    int numOffsets = this->lod == SimulationLOD::FULL ? 32 : 26;
+    this->strainStart = this->nodes;
+    this->strainScratch.resize(this->nodes.size());
+    for(int iter = 0; iter < this->strainIterations; iter++) {
+        #pragma omp parallel for collapse(3)
+        for(int i = 0; i <= this->param1; i++) {
+            for(int j = 0; j <= this->param1; j++) {
+                for(int k = 0; k <= this->param1; k++) {
+                    int ind = getInd(i, j, k);
+                    glm::vec<3, double> correction(0);
+                    int numViolated = 0;
+                    for(int o = 0; o < numOffsets; o++) {
+                        glm::ivec3 other = glm::ivec3(i, j, k) + springOffsets[o];
+                        if(glm::any(glm::lessThan(other, glm::ivec3(0))) || glm::any(glm::greaterThan(other, glm::ivec3(this->param1)))) {
+                            continue;
+                        }
+                        glm::vec<3, double> diff = this->nodes[getInd(other.x, other.y, other.z)] - this->nodes[ind];
+                        double len = glm::length(diff);
+                        double restLen = this->restLen * glm::length(glm::vec<3, double>(springOffsets[o]));
+                        double clampedLen = glm::clamp(len, settings.minStretch * restLen, settings.maxStretch * restLen);
+                        if(clampedLen != len && len > 0) {
+                            correction += (0.5 * (len - clampedLen) / len) * diff;
+                            numViolated++;
+                        }
+                    }
+                    this->strainScratch[ind] = numViolated > 0 ? this->nodes[ind] + correction / (double) numViolated : this->nodes[ind];
+                }
+            }
+        }
+        std::swap(this->nodes, this->strainScratch);
+    }
+
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        this->velocities[ind] += (this->nodes[ind] - this->strainStart[ind]) / dt;
+    }
+}
+
+// Computes the kinetic energy per unit mass, averaged over all nodes
+double JelloCube::getKineticEnergy() {
+    double energy = 0;
+    for(glm::vec<3, double>& velocity : this->velocities) {
+        energy += 0.5 * glm::dot(velocity, velocity);
+    }
+    return energy / this->nodes.size();
+}
+
+// Checks the state after a step for signs of an explosion: non-finite values, a spike in kinetic energy
+// over its value before the step, or a structural spring stretched far past its rest length (compression is
+// left out, since a cube squashed against an obstacle can legitimately compress its springs)
+bool JelloCube::isHealthy(double prevEnergy) {
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        if(glm::any(glm::isnan(this->nodes[ind])) || glm::any(glm::isinf(this->nodes[ind])) ||
+           glm::any(glm::isnan(this->velocities[ind])) || glm::any(glm::isinf(this->velocities[ind]))) {
+            return false;
+        }
+    }
+    if(this->getKineticEnergy() > this->energySpikeFactor * prevEnergy + this->energySpikeFloor) {
+        return false;
+    }
+
+    double maxLen = this->maxStrain * this->restLen;
+    for(int i = 0; i <= this->param1; i++) {
+        for(int j = 0; j <= this->param1; j++) {
+            for(int k = 0; k <= this->param1; k++) {
+                glm::vec<3, double>& node = this->nodes[getInd(i, j, k)];
+                for(glm::ivec3 offset : {glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1)}) {
+                    if(i + offset.x > this->param1 || j + offset.y > this->param1 || k + offset.z > this->param1) {
+                        continue;
+                    }
+                    double len = glm::length(this->nodes[getInd(i + offset.x, j + offset.y, k + offset.z)] - node);
+                    if(len > maxLen) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Checks whether an integrator stays stable at the given timestep, for the damped oscillator x'' = -omegaSq x - damping x'.
+// Euler and RK4 are stable when their stability function R satisfies |R(lambda dt)| <= 1 for both eigenvalues lambda of the
+// oscillator; symplectic Euler (as used by the multirate integrator) when both eigenvalues of its step matrix lie in the unit disk.
+static bool isStable(Integrator integrator, double omegaSq, double damping, double dt) {
+    const double tolerance = 1e-9;
+    if(integrator == Integrator::MULTIRATE) {
+        // Step matrix of (x, v) is [[1 - dt^2 omegaSq, dt (1 - dt damping)], [-dt omegaSq, 1 - dt damping]]
+        double trace = 2 - dt * dt * omegaSq - dt * damping;
+        double det = 1 - dt * damping;
+        std::complex<double> disc = std::sqrt(std::complex<double>(trace * trace / 4 - det));
+        return std::abs(trace / 2 + disc) <= 1 + tolerance && std::abs(trace / 2 - disc) <= 1 + tolerance;
+    }
+
+    std::complex<double> disc = std::sqrt(std::complex<double>(damping * damping / 4 - omegaSq));
+    for(std::complex<double> lambda : {-damping / 2 + disc, -damping / 2 - disc}) {
+        std::complex<double> z = lambda * dt;
+        std::complex<double> r = integrator == Integrator::EULER ? 1.0 + z : 1.0 + z * (1.0 + z / 2.0 * (1.0 + z / 3.0 * (1.0 + z / 4.0)));
+        if(std::abs(r) > 1 + tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Estimates the largest stable timestep (in seconds) for the current integrator. The stiffest mode of the lattice is bounded by
+// treating each node as a damped oscillator, whose stiffness and damping are twice the sum (Gershgorin) of its springs' coefficients
+// projected onto one axis, plus one collision spring. Compressed springs add a transverse stiffness of k (L0 / L - 1), which grows
+// as the shortest spring collapses. The timestep is then found by bisection on the integrator's stability condition.
+double JelloCube::getStableTimestep() {
+    // Shortest structural spring, relative to its rest length
+    double minRatio = 1;
+    for(int i = 0; i <= this->param1; i++) {
+        for(int j = 0; j <= this->param1; j++) {
+            for(int k = 0; k <= this->param1; k++) {
+                glm::vec<3, double>& node = this->nodes[getInd(i, j, k)];
+                if(i < this->param1) minRatio = std::min(minRatio, glm::length(this->nodes[getInd(i+1, j, k)] - node) / this->restLen);
+                if(j < this->param1) minRatio = std::min(minRatio, glm::length(this->nodes[getInd(i, j+1, k)] - node) / this->restLen);
+                if(k < this->param1) minRatio = std::min(minRatio, glm::length(this->nodes[getInd(i, j, k+1)] - node) / this->restLen);
+            }
+        }
+    }
+    double geomFactor = std::max(1.0, 1 / std::max(minRatio, 1e-3) - 1);
+
+    // Springs per node projected onto an axis: 2 structural, 12 face diagonals at 1/2 and 8 corner diagonals at 1/3, 2 bend
+    double axisSprings = this->lod == SimulationLOD::FULL ? 2 + 4 + 8.0 / 3 + 2 : 2 + 4 + 8.0 / 3;
+    double mass = settings.mass * this->massScale;
+    double elasticOmegaSq = 2 * axisSprings * settings.kElastic * this->stiffnessScale * geomFactor / mass;
+    double elasticDamping = 2 * axisSprings * settings.dElastic * this->stiffnessScale / mass;
+    // Constraint-based contacts are resolved outside of the integrator, and do not limit the timestep
+    bool penalty = settings.contactModel == ContactModel::PENALTY;
+    double contactOmegaSq = elasticOmegaSq + (penalty ? settings.kCollision / settings.mass : 0);
+    double contactDamping = elasticDamping + (penalty ? settings.dCollision / settings.mass : 0);
+
+    // Nodes near contacts substep under multirate integration, so only they need to resolve the collision springs
+    double substeps = settings.integrator == Integrator::MULTIRATE ? std::max((int) settings.contactSubsteps, 1) : 1;
+    auto stable = [&](double dt) {
+        return isStable(settings.integrator, elasticOmegaSq, elasticDamping, dt) &&
+               isStable(settings.integrator, contactOmegaSq, contactDamping, dt / substeps);
+    };
+
+    if(stable(this->maxStableTimestep)) {
+        return this->maxStableTimestep;
+    }
+    double lo = 0, hi = this->maxStableTimestep;
+    for(int iter = 0; iter < 40; iter++) {
+        double mid = 0.5 * (lo + hi);
+        if(stable(mid)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return std::max(lo, this->minStableTimestep);
+}
+
+// Puts the cube to sleep once it has stayed at rest for enough consecutive steps
+void JelloCube::updateSleepState(std::vector<glm::vec<3, double>>& acc) {
+    double energy = this->getKineticEnergy(), maxAccSq = 0;
+    for(int ind = 0; ind < this->nodes.size(); ind++) {
+        maxAccSq = std::max(maxAccSq, glm::dot(acc[ind], acc[ind]));
+    }
+
+    bool quiet = energy < this->sleepEnergy && maxAccSq < this->sleepAcceleration * this->sleepAcceleration;
+    this->quietSteps = quiet ? this->quietSteps + 1 : 0;
+    if(this->quietSteps >= this->sleepSteps) {
+        this->asleep = true;
+        this->sleepSettings = settings;
+        std::fill(this->velocities.begin(), this->velocities.end(), glm::vec<3, double>(0));
+    }
+}
+
+void JelloCube::wake() {
+    this->asleep = false;
+    this->quietSteps = 0;
+}
+
+// Fits the bounding box to the nodes, along with the primitive's bounding sphere around it (which the render queue sorts by)
+void JelloCube::calcBounds() {
+    this->boundsMin = this->boundsMax = this->nodes[0];
+    for(glm::vec<3, double>& node : this->nodes) {
+        this->boundsMin = glm::min(this->boundsMin, node);
+        this->boundsMax = glm::max(this->boundsMax, node);
+    }
+    this->boundsCenter = 0.5 * (this->boundsMin + this->boundsMax);
+    this->boundsRadius = 0.5 * glm::length(this->boundsMax - this->boundsMin);
+}
+
+bool JelloCube::overlaps(const JelloCube& other) const {
+    return glm::all(glm::lessThanEqual(this->boundsMin, other.boundsMax)) &&
+           glm::all(glm::lessThanEqual(other.boundsMin, this->boundsMax));
+}
+
+bool JelloCube::overlaps(const Primitive& primitive) const {
+    glm::vec<3, double> center = primitive.getBoundsCenter();
+    glm::vec<3, double> toBox = glm::clamp(center, this->boundsMin, this->boundsMax) - center;
+    return glm::dot(toBox, toBox) <= (double) primitive.getBoundsRadius() * primitive.getBoundsRadius();
+}
+
+// Chooses the simulation level of detail from how large the cube appears from the given camera
+void JelloCube::updateLOD(const Camera& camera) {
+    if(this->asleep) {
+        return;
+    }
+
+    // Fraction of the screen's half-height covered by the cube's bounding sphere
+    glm::vec<3, double> center = 0.5 * (this->boundsMin + this->boundsMax);
+    double radius = 0.5 * glm::length(this->boundsMax - this->boundsMin);
+    double dist = glm::length(glm::vec<3, double>(glm::vec3(camera.getPosition())) - center);
+    double screenSize = radius / (std::max(dist, radius) * std::tan(camera.getHeightAngle() / 2));
+
+    // Only move to a finer level once past its threshold by some margin, to avoid flickering between levels
+    SimulationLOD newLod = SimulationLOD::COARSE;
+    if(!settings.simulationLOD || screenSize >= this->fullLODSize * (this->lod == SimulationLOD::FULL ? 1 : this->lodHysteresis)) {
+        newLod = SimulationLOD::FULL;
+    } else if(screenSize >= this->reducedLODSize * (this->lod != SimulationLOD::COARSE ? 1 : this->lodHysteresis)) {
+        newLod = SimulationLOD::REDUCED;
+    }
+
+    int newParam = newLod == SimulationLOD::COARSE ? std::max(this->fullParam / 2, 2) : this->fullParam;
+    this->lod = newLod;
+    if(newParam != this->param1) {
+        this->resample(newParam);
+    }
+    this->calcMaterialScales();
+}
+
+// Changes the lattice's resolution, transferring the current state by trilinearly
+// resampling node positions and velocities at the new lattice coordinates
+void JelloCube::resample(int newParam) {
+    int oldParam = this->param1;
+    std::vector<glm::vec<3, double>> oldNodes = std::move(this->nodes);
+    std::vector<glm::vec<3, double>> oldVelocities = std::move(this->velocities);
+    auto getOldInd = [oldParam](int i, int j, int k) {
+        return i * (oldParam + 1) * (oldParam + 1) + j * (oldParam + 1) + k;
+    };
+
+    this->param1 = this->param2 = newParam;
+    this->nodes.resize((newParam + 1) * (newParam + 1) * (newParam + 1));
+    this->velocities.resize(this->nodes.size());
+    for(int i = 0; i <= newParam; i++) {
+        for(int j = 0; j <= newParam; j++) {
+            for(int k = 0; k <= newParam; k++) {
+                // Locate the old cell containing this node, and its coordinates within it
+                glm::vec<3, double> oldCoords = glm::vec<3, double>(i, j, k) * ((double) oldParam / newParam);
+                glm::ivec3 cell = glm::min(glm::ivec3(oldCoords), glm::ivec3(oldParam - 1));
+                glm::vec<3, double> t = oldCoords - glm::vec<3, double>(cell);
+
+                int ind = getInd(i, j, k);
+                this->nodes[ind] = glm::vec<3, double>(0);
+                this->velocities[ind] = glm::vec<3, double>(0);
+                for(int corner = 0; corner < 8; corner++) {
+                    glm::ivec3 offset((corner >> 2) & 1, (corner >> 1) & 1, corner & 1);
+                    double weight = (offset.x ? t.x : 1 - t.x) * (offset.y ? t.y : 1 - t.y) * (offset.z ? t.z : 1 - t.z);
+                    int oldInd = getOldInd(cell.x + offset.x, cell.y + offset.y, cell.z + offset.z);
+                    this->nodes[ind] += weight * oldNodes[oldInd];
+                    this->velocities[ind] += weight * oldVelocities[oldInd];
+                }
+            }
+        }
+    }
+    this->initLattice();
 }
 
 void JelloCube::scatter() {
+    this->wake();
     std::uniform_real_distribution<double> sideDis(-20.0, 20.0);
     std::uniform_real_distribution<double> upDis(0, 30.0);
     glm::vec<3, double> velChange(sideDis(this->gen), upDis(this->gen), sideDis(this->gen));
@@ -341,114 +1189,204 @@ void JelloCube::scatter() {
     }
 }
 
+// Builds the surface mesh's static data for the current resolution. For each face, each vertex of its grid gets its lattice node
+// and UV coordinates, along with the nodes before and after it along the grid's axes (clamped to the face's borders, so that the
+// cube's edges stay sharp), from which its normal is found; each grid cell is split into two triangles, wound counterclockwise
+// when seen from outside the cube.
+void JelloCube::calcSurfaceTopology() {
+    int n = this->param1;
+    this->vertexNodes.clear();
+    this->vertexAttribs.clear();
+    this->surfaceIndices.clear();
+    SceneFileMap& texture = this->material.textureMap;
+    for(int axis = 0; axis < 3; axis++) {
+        // The face's grid runs along the other two axes, in increasing order
+        int uAxis = axis == 0 ? 1 : 0;
+        int vAxis = axis == 2 ? 1 : 2;
+        for(int side = 0; side < 2; side++) {
+            bool positive = side == 1;
+            // uAxis x vAxis points along -y for the y faces, and along the axis otherwise
+            bool ccw = positive != (axis == 1);
+            bool flipU = (axis == 0 && positive) || (axis == 2 && !positive);
+            bool flipV = axis == 1 && positive;
+            auto getNode = [&](int a, int b) {
+                glm::ivec3 coords;
+                coords[axis] = positive ? n : 0;
+                coords[uAxis] = std::clamp(a, 0, n);
+                coords[vAxis] = std::clamp(b, 0, n);
+                return this->getInd(coords.x, coords.y, coords.z);
+            };
+
+            GLuint firstVertex = this->vertexNodes.size() / 5;
+            for(int a = 0; a <= n; a++) {
+                for(int b = 0; b <= n; b++) {
+                    // Reversing the neighbours along the first axis flips the normal of clockwise faces
+                    int uBefore = getNode(a - 1, b), uAfter = getNode(a + 1, b);
+                    int vertexNodes[] = {getNode(a, b), ccw ? uBefore : uAfter, ccw ? uAfter : uBefore, getNode(a, b - 1), getNode(a, b + 1)};
+                    this->vertexNodes.insert(this->vertexNodes.end(), vertexNodes, vertexNodes + 5);
+                    float u = (float) a / n, v = (float) b / n;
+                    this->vertexAttribs.push_back((flipU ? 1 - u : u) * texture.repeatU);
+                    this->vertexAttribs.push_back((flipV ? 1 - v : v) * texture.repeatV);
+                }
+            }
+            for(int a = 0; a < n; a++) {
+                for(int b = 0; b < n; b++) {
+                    GLuint v00 = firstVertex + a * (n + 1) + b;
+                    GLuint v10 = v00 + (n + 1), v01 = v00 + 1, v11 = v10 + 1;
+                    GLuint ccwCell[] = {v00, v10, v11, v00, v11, v01};
+                    GLuint cwCell[] = {v00, v11, v10, v00, v01, v11};
+                    GLuint* cell = ccw ? ccwCell : cwCell;
+                    this->surfaceIndices.insert(this->surfaceIndices.end(), cell, cell + 6);
+                }
+            }
+        }
+    }
+    this->topologyParam = n;
+    this->topologyEmbedded = false;
+}
 
+// Binds each of the render mesh's vertices to the lattice cell its rest position lies in, by the cell's first node (its corner
+// with the smallest coordinates) and the vertex's coordinates within the cell; vertices outside the lattice are bound to its
+// nearest cell, with coordinates outside [0, 1], so that they are extrapolated from it. Along with the UV coordinates, each vertex
+// keeps its rest normal, which (as the lattice's cells are cubes at rest) is also its normal in cell coordinates.
+void JelloCube::bindRenderMesh() {
+    const RenderMesh& mesh = *this->renderMesh;
+    int n = this->param1;
+    SceneFileMap& texture = this->material.textureMap;
+    const int numVertices = mesh.positions.size();
+    this->vertexNodes.resize(numVertices);
+    this->vertexAttribs.resize(8 * numVertices);
+    #pragma omp parallel for
+    for(int v = 0; v < numVertices; v++) {
+        glm::vec3 coords = (mesh.positions[v] + 0.5f) * (float) n;
+        glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(coords)), 0, n - 1);
+        glm::vec3 local = coords - glm::vec3(cell);
+        this->vertexNodes[v] = this->getInd(cell.x, cell.y, cell.z);
+        GLfloat* attribs = &this->vertexAttribs[8 * v];
+        attribs[0] = local.x;
+        attribs[1] = local.y;
+        attribs[2] = local.z;
+        attribs[3] = mesh.normals[v].x;
+        attribs[4] = mesh.normals[v].y;
+        attribs[5] = mesh.normals[v].z;
+        attribs[6] = mesh.uvs[v].x * texture.repeatU;
+        attribs[7] = mesh.uvs[v].y * texture.repeatV;
+    }
+    this->surfaceIndices.clear(); // the render mesh's own indices are drawn
+    this->topologyParam = n;
+    this->topologyEmbedded = true;
+}
+
+// Writes the positions of all of the lattice's nodes, as floats, to the given destination
+void JelloCube::writeNodePositions(GLfloat* positions) const {
+    const double* nodes = &this->nodes[0].x;
+    const int numCoords = 3 * this->nodes.size();
+    #pragma omp simd
+    for(int i = 0; i < numCoords; i++) {
+        positions[i] = nodes[i];
+    }
+}
+
+// The vertex data is just the lattice's node positions; the surface is reconstructed from them on the GPU
 const void JelloCube::calcVertexData() {
-    this->vertexData.clear();
-    // +x face
-    for(int j = 0; j < this->param1; j++) {
-        for(int k = 0; k < this->param1; k++) {
-            std::vector<std::pair<int, int>> inds = {{j+1, k+1}, {j+1, k}, {j, k+1}, {j, k}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(this->param1, ind.first, ind.second)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(1 - (ind.first * this->restLen), ind.second * this->restLen);
-            });
-            this->makeTile(vertices, normals, uvs, false);
-        }
-    }
-
-    // -x face
-    for(int j = 0; j < this->param1; j++) {
-        for(int k = 0; k < this->param1; k++) {
-            std::vector<std::pair<int, int>> inds = {{j+1, k}, {j+1, k+1}, {j, k}, {j, k+1}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(0, ind.first, ind.second)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(ind.first * this->restLen, ind.second * this->restLen);
-            });
-            this->makeTile(vertices, normals, uvs, false);
-        }
-    }
-
-    // +y face
-    for(int i = 0; i < this->param1; i++) {
-        for(int k = 0; k < this->param1; k++) {
-            std::vector<std::pair<int, int>> inds = {{i+1, k+1}, {i, k+1}, {i+1, k}, {i, k}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(ind.first, this->param1, ind.second)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(ind.first * this->restLen, 1 - (ind.second * this->restLen));
-            });
-            this->makeTile(vertices, normals, uvs, false);
-        }
-    }
-
-    // -y face
-    for(int i = 0; i < this->param1; i++) {
-        for(int k = 0; k < this->param1; k++) {
-            std::vector<std::pair<int, int>> inds = {{i, k+1}, {i+1, k+1}, {i, k}, {i+1, k}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(ind.first, 0, ind.second)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(ind.first * this->restLen, ind.second * this->restLen);
-            });
-            this->makeTile(vertices, normals, uvs, false);
-        }
-    }
-
-    // +z face
-    for(int i = 0; i < this->param1; i++) {
-        for(int j = 0; j < this->param1; j++) {
-            std::vector<std::pair<int, int>> inds = {{i, j+1}, {i+1, j+1}, {i, j}, {i+1, j}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(ind.first, ind.second, this->param1)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(ind.first * this->restLen, ind.second * this->restLen);
-            });
-            this->makeTile(vertices, normals, uvs, false);
-        }
-    }
-
-    // -z face
-    for(int i = 0; i < this->param1; i++) {
-        for(int j = 0; j < this->param1; j++) {
-            std::vector<std::pair<int, int>> inds = {{i+1, j+1}, {i, j+1}, {i+1, j}, {i, j}};
-            std::vector<glm::vec3> vertices(inds.size());
-            std::transform(inds.begin(), inds.end(), vertices.begin(), [this](std::pair<int, int> ind) -> glm::vec3 {
-                return nodes[this->getInd(ind.first, ind.second, 0)];
-            });
-            glm::vec3 normal = glm::cross(vertices[3] - vertices[2], vertices[0] - vertices[2]);
-            std::vector<glm::vec3> normals = {normal, normal, normal, normal};
-            std::vector<glm::vec2> uvs(inds.size());
-            std::transform(inds.begin(), inds.end(), uvs.begin(), [this](std::pair<int, int> ind) -> glm::vec2 {
-                return glm::vec2(1 - (ind.first * this->restLen), ind.second * this->restLen);
-            });
-            this->makeTile(vertices, normals, uvs, false);
+    bool embedded = this->drawsRenderMesh();
+    if(this->topologyParam != this->param1 || this->topologyEmbedded != embedded) {
+        if(embedded) {
+            this->bindRenderMesh();
+        } else {
+            this->calcSurfaceTopology();
         }
     }
+    this->vertexData.resize(3 * this->nodes.size());
+    this->writeNodePositions(this->vertexData.data());
+}
+
+// Uploads the node positions into the stream buffer, and sets up a texture buffer over it to fetch them from; then uploads the
+// drawn mesh's static per-vertex nodes, attributes and indices. The node positions live in a buffer of their own,
+// rather than the primitive's VBO, since they are streamed.
+const void JelloCube::initializeBuffers() {
+    if(this->nodeVbo == 0) {
+        glErrorCheck(glGenBuffers(1, &this->nodeVbo));
+        glErrorCheck(glGenBuffers(1, &this->attribVbo));
+        glErrorCheck(glGenBuffers(1, &this->ebo));
+        glErrorCheck(glGenTextures(1, &this->nodeTexture));
+    }
+
+    this->vertexStream.allocate(sizeof(GLfloat) * this->vertexData.size());
+    std::copy(this->vertexData.begin(), this->vertexData.end(), static_cast<GLfloat*>(this->vertexStream.beginWrite()));
+    this->vertexStream.endWrite();
+    glErrorCheck(glBindTexture(GL_TEXTURE_BUFFER, this->nodeTexture));
+    glErrorCheck(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, this->vertexStream.getBuffer()));
+    glErrorCheck(glBindTexture(GL_TEXTURE_BUFFER, 0));
+
+    glErrorCheck(glBindVertexArray(this->vao));
+
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->nodeVbo));
+    glErrorCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * this->vertexNodes.size(), this->vertexNodes.data(), GL_STATIC_DRAW));
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->attribVbo));
+    glErrorCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * this->vertexAttribs.size(), this->vertexAttribs.data(), GL_STATIC_DRAW));
+    const std::vector<GLuint>& indices = this->topologyEmbedded ? this->renderMesh->indices : this->surfaceIndices;
+    if(this->topologyEmbedded) {
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->nodeVbo));
+        glErrorCheck(glEnableVertexAttribArray(0));
+        glErrorCheck(glVertexAttribIPointer(0, 1, GL_INT, sizeof(GLint), reinterpret_cast<void*>(0)));
+        glErrorCheck(glDisableVertexAttribArray(1));
+
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->attribVbo));
+        glErrorCheck(glEnableVertexAttribArray(3));
+        glErrorCheck(glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void*>(0 * sizeof(GLfloat))));
+        glErrorCheck(glEnableVertexAttribArray(4));
+        glErrorCheck(glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void*>(3 * sizeof(GLfloat))));
+        glErrorCheck(glEnableVertexAttribArray(2));
+        glErrorCheck(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void*>(6 * sizeof(GLfloat))));
+    } else {
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->nodeVbo));
+        glErrorCheck(glEnableVertexAttribArray(0));
+        glErrorCheck(glVertexAttribIPointer(0, 1, GL_INT, 5 * sizeof(GLint), reinterpret_cast<void*>(0 * sizeof(GLint))));
+        glErrorCheck(glEnableVertexAttribArray(1));
+        glErrorCheck(glVertexAttribIPointer(1, 4, GL_INT, 5 * sizeof(GLint), reinterpret_cast<void*>(1 * sizeof(GLint))));
+
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->attribVbo));
+        glErrorCheck(glDisableVertexAttribArray(3));
+        glErrorCheck(glDisableVertexAttribArray(4));
+        glErrorCheck(glEnableVertexAttribArray(2));
+        glErrorCheck(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), reinterpret_cast<void*>(0)));
+    }
+
+    // The index buffer binding is part of the VAO's state
+    glErrorCheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo));
+    glErrorCheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW));
+    this->numIndices = indices.size();
+
+    glErrorCheck(glBindVertexArray(0));
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    this->uploadedParam = this->topologyParam;
+    this->uploadedEmbedded = this->topologyEmbedded;
+}
+
+// Writes the node positions at the end of an update straight into the stream buffer, unless the resolution
+// or the drawn mesh has changed since the buffers were last set up
+void JelloCube::uploadVertexData() {
+    if(this->uploadedParam != this->param1 || this->uploadedEmbedded != this->drawsRenderMesh()) {
+        this->calcVertexData();
+        this->initializeBuffers();
+        return;
+    }
+    this->writeNodePositions(static_cast<GLfloat*>(this->vertexStream.beginWrite()));
+    this->vertexStream.endWrite();
+}
+
+// Draws with the node positions in the stream buffer's latest region, which the shader fetches from texture unit 1
+const void JelloCube::drawGeometry(const ShaderUniforms& shader) const {
+    glErrorCheck(glActiveTexture(GL_TEXTURE1));
+    glErrorCheck(glBindTexture(GL_TEXTURE_BUFFER, this->nodeTexture));
+    glErrorCheck(glUniform1i(shader.nodeOffset, this->vertexStream.getOffset() / (3 * sizeof(GLfloat))));
+    glErrorCheck(glUniform1i(shader.embedded, this->uploadedEmbedded));
+    glErrorCheck(glUniform1i(shader.latticeSize, this->uploadedParam + 1));
+
+    glErrorCheck(glDrawElements(GL_TRIANGLES, this->numIndices, GL_UNSIGNED_INT, reinterpret_cast<void*>(0)));
+    this->vertexStream.fence();
+
+    glErrorCheck(glBindTexture(GL_TEXTURE_BUFFER, 0));
+    glErrorCheck(glActiveTexture(GL_TEXTURE0));
 }
@@ -2,17 +2,60 @@
 #define JELLOCUBE_H
 
 #include "primitives.h"
+#include "camera.h"
+#include "settings.h"
+#include "rendermesh.h"
+#include "utils/streambuffer.h"
+#include <memory>
 #include <random>
 #include <span>
 
+// Simulation level of detail of a jello cube, chosen by how large it appears on screen
+enum class SimulationLOD {
+    FULL,    // all springs, at full lattice resolution
+    REDUCED, // bend springs dropped
+    COARSE   // bend springs dropped, and lattice resolution halved
+};
+
 class JelloCube : public Cube {
 public:
     JelloCube(const SceneMaterial& material, int param, glm::vec<3, double> center);
+    ~JelloCube() override;
 
-    void update(std::span<std::unique_ptr<Primitive>>& primitives);
+    // Advances the cube by dt seconds, colliding with the given primitives in their poses at the end of the step
+    void update(std::span<std::unique_ptr<Primitive>>& primitives, double dt);
     void scatter();
 
+    // Sleeping cubes skip simulation and mesh updates entirely, until woken up
+    void wake();
+    bool isAsleep() const {
+        return this->asleep;
+    }
+    // Checks whether the axis-aligned bounding boxes of this and another cube overlap
+    bool overlaps(const JelloCube& other) const;
+    // Checks whether the axis-aligned bounding box of this cube overlaps the bounding sphere of a primitive
+    bool overlaps(const Primitive& primitive) const;
+
+    void updateLOD(const Camera& camera);
+
+    // Estimates the largest timestep (in seconds) at which the current integrator remains stable
+    double getStableTimestep();
+    double getTimestep();
+
+    // Sets the mesh to draw in place of the lattice's surface (while embedded render meshes are enabled); it is deformed
+    // along with the lattice, by interpolating the nodes of the cell each of its vertices rests in
+    void setRenderMesh(std::shared_ptr<const RenderMesh> mesh) {
+        this->renderMesh = std::move(mesh);
+    }
+
     const void calcVertexData() override;
+    const void drawGeometry(const ShaderUniforms& shader) const override;
+protected:
+    // Each cube's mesh follows its own lattice, so it is never shared
+    std::optional<GeometryKey> getGeometryKey() const override {
+        return std::nullopt;
+    }
+    const void initializeBuffers() override;
 private:
     double restLen; // resting length between two adjacent nodes
     std::vector<glm::vec<3, double>> nodes; // contains param^3 nodes, which internally interact
@@ -46,14 +89,162 @@ private:
     glm::vec<3, double> getStructuralForce(int i, int j, int k);
     glm::vec<3, double> getShearForce(int i, int j, int k);
     glm::vec<3, double> getBendForce(int i, int j, int k);
-    glm::vec<3, double> getCollisionForce(int i, int j, int k, std::span<std::unique_ptr<Primitive>>& primitives);
+    void findContacts(std::vector<glm::vec<3, double>>& positions,
+                      std::span<std::unique_ptr<Primitive>>& primitives,
+                      std::vector<int>& candidates,
+                      std::vector<std::vector<int>>& contactCandidates);
+    void computeCollisionForces(std::vector<glm::vec<3, double>>& positions,
+                                std::vector<glm::vec<3, double>>& velocities,
+                                std::span<std::unique_ptr<Primitive>>& primitives);
+    void computeCollisionForces(std::vector<glm::vec<3, double>>& positions,
+                                std::vector<glm::vec<3, double>>& velocities,
+                                std::span<std::unique_ptr<Primitive>>& primitives,
+                                std::vector<int>& candidates,
+                                std::vector<std::vector<int>>& contactCandidates);
+    void initLattice();
+    void calcMaterialScales();
+    void resample(int newParam);
+    bool isCellInverted(int i, int j, int k);
+    void updateSleepState(std::vector<glm::vec<3, double>>& acc);
+    void step(double dt, std::vector<glm::vec<3, double>>& acc, std::span<std::unique_ptr<Primitive>>& primitives);
+    double getKineticEnergy();
+    bool isHealthy(double prevEnergy);
+    void limitStrain(double dt);
+    void resolveContacts(std::span<std::unique_ptr<Primitive>>& primitives);
+    void constrainAcceleration(std::vector<glm::vec<3, double>>& acc, std::vector<int>& inds);
+    void sweepContacts(double dt, std::span<std::unique_ptr<Primitive>>& primitives);
+    void calcBounds();
+    void updateContactCache(double dt, std::span<std::unique_ptr<Primitive>>& primitives);
+    void refitContactCandidates(int p, const Primitive& primitive, std::vector<int>& candidates);
     void computeAcceleration(std::vector<glm::vec<3, double>>& nodes,
                              std::vector<glm::vec<3, double>>& velocities,
                              std::vector<glm::vec<3, double>>& acc,
                              std::span<std::unique_ptr<Primitive>>& primitives);
+    glm::vec<3, double> getAcceleration(int i, int j, int k);
+    void findActiveNodes(std::span<std::unique_ptr<Primitive>>& primitives);
+    void multirateStep(double dt, std::vector<glm::vec<3, double>>& acc,
+                       std::span<std::unique_ptr<Primitive>>& primitives);
+
+    // Indices of the nodes checked for collisions; while the lattice is intact, only the
+    // surface shell can touch an obstacle, so interior nodes are only checked as a fallback
+    // when an inverted cell is detected (at the start of the last step)
+    std::vector<int> surfaceInds, allInds;
+    bool checkInterior = false, foundInvertedCell = false;
+
+    // Broad-phase contact cache, persisted across steps: for each primitive, the candidate nodes
+    // lying within its bounding sphere (inflated by a margin) as of the last refresh. Only these
+    // pairs reach the narrow phase, in every integration stage, until the cache is refreshed
+    // every few steps, or sooner if a node may move past the margin or the primitives change.
+    // A moving primitive only has its own candidates refitted, once it moves past the margin.
+    // The margin is widened for refreshes before steps long enough to cover much of it.
+    std::vector<std::vector<int>> contactCandidates;
+    std::vector<Primitive*> cachedPrimitives;
+    std::vector<glm::vec<3, double>> cachedPositions;
+    std::vector<glm::vec<3, double>> cachedCenters; // center and radius of each primitive's bounding sphere, as of its last refit
+    std::vector<double> cachedRadii;
+    bool cachedInterior = false;
+    int stepsSinceRefresh = 0;
+    const int contactRefreshSteps = 20;
+    const double contactMargin = 0.2;
+    double cachedMargin = 0.2; // margin of the last refresh
+
+    // Scratch buffers for batched collision queries, in structure-of-arrays form
+    std::vector<double> queryX, queryY, queryZ;
+    std::vector<double> interX, interY, interZ;
+    std::vector<uint8_t> interHits;
+    std::vector<glm::vec<3, double>> collisionForces; // collision force on each node
+
+    // A node penetrating an obstacle or the scene's bounds, the closest point on the surface it penetrates, and that point's velocity
+    struct Contact {
+        int ind;
+        glm::vec<3, double> point;
+        glm::vec<3, double> velocity;
+    };
+    std::vector<Contact> contacts;
+
+    // Constraint-based contact state: the surface normal (zero if not in contact), surface point and its velocity, of the surface
+    // each node rests on. A node leaves the surface once it has moved further than the skin distance away from it.
+    std::vector<glm::vec<3, double>> contactNormals, contactPoints, contactVelocities;
+    const double contactSkin = 1e-4;
+
+    // Continuous collision detection state: the positions at the start of the current step,
+    // and the primitives whose bounding spheres the candidate nodes may have swept through
+    std::vector<glm::vec<3, double>> sweepStart;
+    std::vector<Primitive*> sweptPrimitives;
+    const double ccdDisplacement = 0.02;
+
+    // Multirate integration state: nodes near contacts (active) substep, while the rest (passive) take a
+    // single step; the passive nodes within reach of an active node's springs form the interface
+    std::vector<uint8_t> activeMask, interfaceMask;
+    std::vector<int> activeInds, interfaceInds, activeCandidates;
+    std::vector<std::vector<int>> activeContactCandidates;
+    std::vector<glm::vec<3, double>> stepStartPos, stepStartVel, stepEndPos;
+
+    // Sleep state; a cube falls asleep once its kinetic energy (per unit mass, averaged over nodes)
+    // and the residual acceleration of every node have stayed small for enough consecutive steps
+    bool asleep = false;
+    int quietSteps = 0;
+    Settings sleepSettings; // settings when the cube fell asleep, so that any change wakes it
+    const double sleepEnergy = 1e-6;
+    const double sleepAcceleration = 0.05;
+    const int sleepSteps = 250;
+
+    // Level of detail; the thresholds are fractions of the screen's half-height covered by the cube
+    SimulationLOD lod = SimulationLOD::FULL;
+    int fullParam; // lattice resolution at full detail
+    double massScale = 1, stiffnessScale = 1; // node mass, and elastic spring coefficients, relative to the full lattice's
+    const double fullLODSize = 0.08;
+    const double reducedLODSize = 0.04;
+    const double lodHysteresis = 1.25;
+
+    // Surface mesh: each face of the lattice is drawn as a grid of (param + 1)^2 vertices, duplicated along the cube's edges
+    // (where the faces' UV coordinates differ). Each vertex only stores the lattice nodes its position and normal come from,
+    // so the mesh's data only changes with the resolution, and is uploaded once; each update only streams the node positions,
+    // which the vertex shader fetches from a texture buffer to reconstruct the surface.
+    // With an embedded render mesh, the render mesh is drawn instead, its vertices bound to the lattice cells they rest in.
+    std::vector<GLint> vertexNodes; // for each vertex: its node, then its neighbours' nodes; or its cell's first node (see jello.vert)
+    std::vector<GLfloat> vertexAttribs; // for each vertex: its UV coordinates; or its cell coordinates, rest normal and UV coordinates
+    std::vector<GLuint> surfaceIndices;
+    int topologyParam = 0; // resolution the vertices' nodes were found for
+    bool topologyEmbedded = false; // whether they were found for the render mesh
+    int uploadedParam = 0; // resolution and mesh the static buffers were last uploaded for
+    bool uploadedEmbedded = false;
+    GLuint nodeVbo = 0, attribVbo = 0, ebo = 0, nodeTexture = 0;
+    GLsizei numIndices = 0;
+    mutable StreamBuffer vertexStream; // mutable, as drawing fences the region drawn from
+    std::shared_ptr<const RenderMesh> renderMesh;
+    bool drawsRenderMesh() const {
+        return settings.embeddedRenderMesh && this->renderMesh != nullptr;
+    }
+    void calcSurfaceTopology();
+    void bindRenderMesh();
+    void writeNodePositions(GLfloat* positions) const;
+    void uploadVertexData();
+
+    // Axis-aligned bounding box of the nodes
+    glm::vec<3, double> boundsMin, boundsMax;
 
     std::mt19937 gen; // For scattering
 
+    // Explosion recovery: the state at the start of the current update is kept to roll back to whenever a step fails its
+    // health checks, after which the update is retried in steps scaled down by half, before ramping back up to the full step
+    std::vector<glm::vec<3, double>> lastGoodNodes, lastGoodVelocities;
+    double stepScale = 1;
+    const double stepRamp = 1.25;
+    const int maxStepRetries = 6;
+    const double energySpikeFactor = 4; // kinetic energy (per unit mass) may grow by this factor per step,
+    const double energySpikeFloor = 10; // plus this amount
+    const double maxStrain = 4; // maximum ratio between a structural spring's length and its rest length
+
+    // Strain limiting scratch buffers
+    std::vector<glm::vec<3, double>> strainStart, strainScratch;
+    const int strainIterations = 4;
+
+    // Range of automatically chosen timesteps (in seconds)
+    const double minStableTimestep = 1e-5;
+    const double maxStableTimestep = 1e-2;
+    double timestep = 0; // last timestep requested under automatic timesteps
+
     const float maxPos = 1000;
 };
 
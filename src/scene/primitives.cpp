@@ -1,5 +1,8 @@
 #include "primitives.h"
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <glm/gtc/matrix_transform.hpp>
 
 // Inserts a 3D vector into the given vector of data
 template <int dim>
@@ -12,6 +15,31 @@ inline glm::vec3 sphericalToCartesian(float radius, float theta, float phi) {
     return radius * glm::vec3(glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta));
 }
 
+// Geometry uploaded by primitives which allow sharing it, by their shapes; entries expire along with their last user
+static std::map<GeometryKey, std::weak_ptr<SharedGeometry>> geometryCache;
+
+bool Primitive::findSharedGeometry(const GeometryKey& key) {
+    auto entry = geometryCache.find(key);
+    if(entry == geometryCache.end()) {
+        return false;
+    }
+    this->geometry = entry->second.lock();
+    if(this->geometry == nullptr) {
+        geometryCache.erase(entry);
+        return false;
+    }
+    return true;
+}
+
+// Hands ownership of the primitive's freshly uploaded buffers over to a new shared geometry
+void Primitive::shareGeometry(const GeometryKey& key) {
+    this->geometry = std::make_shared<SharedGeometry>();
+    this->geometry->vbo = this->vbo;
+    this->geometry->vao = this->vao;
+    this->geometry->numVertices = this->numVertices;
+    geometryCache[key] = this->geometry;
+}
+
 void TessellatedPrimitive::makeTile(std::vector<glm::vec3>& vertices,
                                     std::vector<glm::vec3>& normals,
                                     std::vector<glm::vec2>& uvs,
@@ -103,8 +131,53 @@ const void Cube::calcVertexData() {
              [](glm::vec3 pos) -> glm::vec2 { return glm::vec2(0.5 - pos.x, pos.y + 0.5); });
 }
 
+// Interpolates the keyframes around the given time, wrapped around to the span of the animation
+void Primitive::animate(float time, float dt) {
+    if(this->keyframes.size() < 2) {
+        return;
+    }
+    const Keyframe& first = this->keyframes.front();
+    float span = this->keyframes.back().time - first.time;
+    time = first.time + std::fmod(time, span);
+
+    int k = 0;
+    while(k + 2 < this->keyframes.size() && this->keyframes[k + 1].time < time) {
+        k++;
+    }
+    const Keyframe& from = this->keyframes[k];
+    const Keyframe& to = this->keyframes[k + 1];
+    float t = std::clamp((time - from.time) / (to.time - from.time), 0.0f, 1.0f);
+
+    glm::mat4 ctm = glm::translate(glm::mat4(1), glm::mix(from.translation, to.translation, t)) *
+                    glm::mat4_cast(glm::slerp(from.rotation, to.rotation, t)) *
+                    glm::scale(glm::mat4(1), glm::mix(from.scale, to.scale, t));
+    this->setTransform(ctm, dt);
+}
+
+// Packs the cube into an oriented box, if its transformation allows
+void Cube::calcCollisionShape() {
+    glm::vec3 scale;
+    this->hasBox = this->calcFrame(this->box.center, this->box.axes, scale);
+    this->box.halfExtents = this->boundCoord * scale;
+}
+
 const std::optional<glm::vec3> Cube::findIntersectionPoint(glm::vec3 point) {
-    glm::vec4 objSpacePoint = this->worldToObject * glm::vec4(point, 1);
+    if(this->hasBox) {
+        const OrientedBox& box = this->box;
+        glm::vec3 toPoint = point - box.center;
+        glm::vec3 local(glm::dot(toPoint, box.axes[0]), glm::dot(toPoint, box.axes[1]), glm::dot(toPoint, box.axes[2]));
+        glm::vec3 faceDist = box.halfExtents - glm::abs(local);
+        if(faceDist.x < 0 || faceDist.y < 0 || faceDist.z < 0) {
+            return std::nullopt;
+        }
+        // point is inside cube; push it out through the closest face (in world-space distance)
+        int axis = (faceDist.x <= faceDist.y && faceDist.x <= faceDist.z) ? 0 : (faceDist.y <= faceDist.z ? 1 : 2);
+        float faceCoord = local[axis] <= 0 ? -box.halfExtents[axis] : box.halfExtents[axis];
+        return point + (faceCoord - local[axis]) * box.axes[axis];
+    }
+
+    // Otherwise, the transformation shears, so test in object space instead
+    glm::vec4 objSpacePoint = this->getWorldToObject() * glm::vec4(point, 1);
     if(-0.5 <= objSpacePoint.x && objSpacePoint.x <= 0.5 &&
        -0.5 <= objSpacePoint.y && objSpacePoint.y <= 0.5 &&
         -0.5 <= objSpacePoint.z && objSpacePoint.z <= 0.5) {
@@ -135,6 +208,95 @@ const std::optional<glm::vec3> Cube::findIntersectionPoint(glm::vec3 point) {
     return std::nullopt;
 }
 
+// Branchless, structure-of-arrays version of the above, so that the loop can be vectorized
+const void Cube::findIntersectionPoints(const PointBatch& points, IntersectionBatch& out) {
+    if(!this->hasBox) {
+        Primitive::findIntersectionPoints(points, out);
+        return;
+    }
+
+    const glm::vec3 center = this->box.center;
+    const glm::vec3 axisX = this->box.axes[0], axisY = this->box.axes[1], axisZ = this->box.axes[2];
+    const glm::vec3 halfExtents = this->box.halfExtents;
+    const double* px = points.x.data();
+    const double* py = points.y.data();
+    const double* pz = points.z.data();
+    double* ox = out.x.data();
+    double* oy = out.y.data();
+    double* oz = out.z.data();
+    uint8_t* hit = out.hit.data();
+    const size_t numPoints = points.x.size();
+
+    #pragma omp simd
+    for(size_t i = 0; i < numPoints; i++) {
+        float dx = px[i] - center.x, dy = py[i] - center.y, dz = pz[i] - center.z;
+        float localX = dx * axisX.x + dy * axisX.y + dz * axisX.z;
+        float localY = dx * axisY.x + dy * axisY.y + dz * axisY.z;
+        float localZ = dx * axisZ.x + dy * axisZ.y + dz * axisZ.z;
+
+        // Slab test against the three pairs of faces
+        float distX = halfExtents.x - std::abs(localX);
+        float distY = halfExtents.y - std::abs(localY);
+        float distZ = halfExtents.z - std::abs(localZ);
+        hit[i] = distX >= 0 && distY >= 0 && distZ >= 0;
+
+        // Push out through the closest face
+        bool faceX = distX <= distY && distX <= distZ;
+        bool faceY = !faceX && distY <= distZ;
+        bool faceZ = !faceX && !faceY;
+        float moveX = faceX ? (localX <= 0 ? -halfExtents.x : halfExtents.x) - localX : 0;
+        float moveY = faceY ? (localY <= 0 ? -halfExtents.y : halfExtents.y) - localY : 0;
+        float moveZ = faceZ ? (localZ <= 0 ? -halfExtents.z : halfExtents.z) - localZ : 0;
+
+        ox[i] = px[i] + moveX * axisX.x + moveY * axisY.x + moveZ * axisZ.x;
+        oy[i] = py[i] + moveX * axisX.y + moveY * axisY.y + moveZ * axisZ.y;
+        oz[i] = pz[i] + moveX * axisX.z + moveY * axisY.z + moveZ * axisZ.z;
+    }
+}
+
+// Clips an object-space segment against the three slabs of the box [-halfExtent, halfExtent]^3, returning false if it
+// misses the box. Otherwise, the segment lies in the box between tEnter and tExit, having entered through the face of the
+// slab it entered last (whose outward normal is given), provided that it didn't start inside the box (given a zero normal).
+static bool clipToBox(glm::vec3 start, glm::vec3 dir, float halfExtent, float& tEnter, float& tExit, glm::vec3& enterNormal) {
+    tEnter = 0;
+    tExit = 1;
+    enterNormal = glm::vec3(0);
+    for(int axis = 0; axis < 3; axis++) {
+        if(std::abs(dir[axis]) < 1e-12f) {
+            if(std::abs(start[axis]) > halfExtent) {
+                return false; // moving parallel to, and outside of, this slab
+            }
+            continue;
+        }
+        float t1 = (-halfExtent - start[axis]) / dir[axis];
+        float t2 = (halfExtent - start[axis]) / dir[axis];
+        if(t1 > t2) {
+            std::swap(t1, t2);
+        }
+        if(t1 > tEnter) {
+            tEnter = t1;
+            enterNormal = glm::vec3(0);
+            enterNormal[axis] = dir[axis] > 0 ? -1 : 1;
+        }
+        tExit = std::min(tExit, t2);
+        if(tEnter > tExit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::optional<Impact> Cube::findTimeOfImpact(glm::vec3 start, glm::vec3 end) {
+    glm::vec3 objStart = this->getWorldToObject() * glm::vec4(start, 1);
+    glm::vec3 objEnd = this->getWorldToObject() * glm::vec4(end, 1);
+
+    float tEnter, tExit;
+    glm::vec3 objNormal;
+    if(!clipToBox(objStart, objEnd - objStart, this->boundCoord, tEnter, tExit, objNormal) || objNormal == glm::vec3(0)) {
+        return std::nullopt; // the segment misses the cube, or starts inside it
+    }
+    return Impact{tEnter, glm::normalize(this->getObjNormalToWorld() * objNormal)};
+}
 
 const void Sphere::calcVertexData() {
     this->vertexData.clear();
@@ -163,8 +325,77 @@ const void Sphere::calcVertexData() {
     }
 }
 
+// Packs the sphere into an ellipsoid, if its transformation allows
+void Sphere::calcCollisionShape() {
+    glm::vec3 scale;
+    this->hasEllipsoid = this->calcFrame(this->ellipsoid.center, this->ellipsoid.axes, scale);
+    this->ellipsoid.radii = this->radius * scale;
+    glm::vec3& radii = this->ellipsoid.radii;
+    this->ellipsoid.minAxis = (radii.x <= radii.y && radii.x <= radii.z) ? 0 : (radii.y <= radii.z ? 1 : 2);
+}
+
+// Finds the closest point on the surface of an origin-centered, axis-aligned ellipsoid to a point inside it.
+// The closest point is r_i^2 p_i / (t + r_i^2) along each axis i, for the root t in (-r_min^2, 0] of
+// F(t) = sum_i (r_i p_i / (t + r_i^2))^2 - 1. Newton's method is applied to 1 - 1 / sqrt(F(t) + 1) instead,
+// which stays close to linear near the pole at -r_min^2, starting from the lower bound -r_min^2 + r_min |p_min|
+// on the root. A fixed number of iterations keeps this usable within vectorized loops.
+// A point with p_min = 0 may instead lie on the medial disk, where F stays at most 0 all the way to the pole; its closest
+// points are then off that plane, at the pole's solution for the other axes and r_min sqrt(1 - sum of their q_i^2) along the
+// shortest axis (the positive of the two, which are equally close). This includes the center of the ellipsoid.
+static inline glm::vec3 closestPointInEllipsoid(glm::vec3 point, glm::vec3 radii, int minAxis) {
+    glm::vec3 radiiSq = radii * radii;
+    float minRadius = radii[minAxis];
+    float pole = -minRadius * minRadius;
+    if(point[minAxis] == 0) {
+        glm::vec3 medial(0);
+        float sumSq = 0;
+        for(int axis = 0; axis < 3; axis++) {
+            if(axis != minAxis && point[axis] != 0) {
+                medial[axis] = radiiSq[axis] * point[axis] / (pole + radiiSq[axis]);
+                sumSq += medial[axis] * medial[axis] / radiiSq[axis];
+            }
+        }
+        if(sumSq <= 1) {
+            medial[minAxis] = minRadius * std::sqrt(1 - sumSq);
+            return medial;
+        }
+    }
+
+    // Keep t a small distance above the pole, which it would otherwise reach (in float) when p_min is 0
+    float minT = pole + 1e-6f * minRadius * minRadius;
+    float t = std::max(pole + minRadius * std::abs(point[minAxis]), minT);
+    for(int iter = 0; iter < 6; iter++) {
+        glm::vec3 denom = t + radiiSq;
+        glm::vec3 q = radii * point / denom;
+        glm::vec3 qSq = q * q;
+        float sum = std::max(qSq.x + qSq.y + qSq.z, 1e-12f);
+        float invSqrt = 1 / std::sqrt(sum);
+        float g = 1 - invSqrt;
+        float dg = -(qSq.x / denom.x + qSq.y / denom.y + qSq.z / denom.z) * invSqrt / sum;
+        t = std::max(t - g / dg, std::max(0.5f * (t + pole), minT)); // never step past the pole
+    }
+    glm::vec3 closest = radiiSq * point / (t + radiiSq);
+    // Snap onto the surface, to absorb any remaining error
+    glm::vec3 scaled = closest / radii;
+    return closest / std::sqrt(std::max(glm::dot(scaled, scaled), 1e-12f));
+}
+
 const std::optional<glm::vec3> Sphere::findIntersectionPoint(glm::vec3 point) {
-    glm::vec3 objSpacePoint = this->worldToObject * glm::vec4(point, 1);
+    if(this->hasEllipsoid) {
+        const Ellipsoid& ellipsoid = this->ellipsoid;
+        glm::vec3 toPoint = point - ellipsoid.center;
+        glm::vec3 local(glm::dot(toPoint, ellipsoid.axes[0]), glm::dot(toPoint, ellipsoid.axes[1]), glm::dot(toPoint, ellipsoid.axes[2]));
+        glm::vec3 scaled = local / ellipsoid.radii;
+        if(glm::dot(scaled, scaled) > 1) {
+            return std::nullopt;
+        }
+        // point is inside sphere
+        glm::vec3 closest = closestPointInEllipsoid(local, ellipsoid.radii, ellipsoid.minAxis);
+        return ellipsoid.center + closest.x * ellipsoid.axes[0] + closest.y * ellipsoid.axes[1] + closest.z * ellipsoid.axes[2];
+    }
+
+    // Otherwise, the transformation shears, so test in object space instead
+    glm::vec3 objSpacePoint = this->getWorldToObject() * glm::vec4(point, 1);
     if(glm::length(objSpacePoint) <= 0.5) {
         // point is inside sphere
         glm::vec4 interPoint = glm::vec4(glm::normalize(objSpacePoint) * 0.5f, 1);
@@ -172,3 +403,276 @@ const std::optional<glm::vec3> Sphere::findIntersectionPoint(glm::vec3 point) {
     }
     return std::nullopt;
 }
+
+// Structure-of-arrays version of the above, so that the loop can be vectorized
+const void Sphere::findIntersectionPoints(const PointBatch& points, IntersectionBatch& out) {
+    if(!this->hasEllipsoid) {
+        Primitive::findIntersectionPoints(points, out);
+        return;
+    }
+
+    const glm::vec3 center = this->ellipsoid.center;
+    const glm::vec3 axisX = this->ellipsoid.axes[0], axisY = this->ellipsoid.axes[1], axisZ = this->ellipsoid.axes[2];
+    const glm::vec3 radii = this->ellipsoid.radii;
+    const int minAxis = this->ellipsoid.minAxis;
+    const double* px = points.x.data();
+    const double* py = points.y.data();
+    const double* pz = points.z.data();
+    double* ox = out.x.data();
+    double* oy = out.y.data();
+    double* oz = out.z.data();
+    uint8_t* hit = out.hit.data();
+    const size_t numPoints = points.x.size();
+
+    #pragma omp simd
+    for(size_t i = 0; i < numPoints; i++) {
+        float dx = px[i] - center.x, dy = py[i] - center.y, dz = pz[i] - center.z;
+        glm::vec3 local(dx * axisX.x + dy * axisX.y + dz * axisX.z,
+                        dx * axisY.x + dy * axisY.y + dz * axisY.z,
+                        dx * axisZ.x + dy * axisZ.y + dz * axisZ.z);
+        glm::vec3 scaled = local / radii;
+        hit[i] = glm::dot(scaled, scaled) <= 1;
+
+        glm::vec3 closest = closestPointInEllipsoid(local, radii, minAxis);
+        ox[i] = center.x + closest.x * axisX.x + closest.y * axisY.x + closest.z * axisZ.x;
+        oy[i] = center.y + closest.x * axisX.y + closest.y * axisY.y + closest.z * axisZ.y;
+        oz[i] = center.z + closest.x * axisX.z + closest.y * axisY.z + closest.z * axisZ.z;
+    }
+}
+
+// Solves |start + t * (end - start)| = radius for the smaller root in object space
+const std::optional<Impact> Sphere::findTimeOfImpact(glm::vec3 start, glm::vec3 end) {
+    glm::vec3 objStart = this->getWorldToObject() * glm::vec4(start, 1);
+    glm::vec3 objEnd = this->getWorldToObject() * glm::vec4(end, 1);
+    glm::vec3 dir = objEnd - objStart;
+
+    float a = glm::dot(dir, dir);
+    float b = 2 * glm::dot(objStart, dir);
+    float c = glm::dot(objStart, objStart) - this->radius * this->radius;
+    if(c <= 0 || a < 1e-12f) {
+        return std::nullopt; // the segment starts inside the sphere, or doesn't move
+    }
+    float discriminant = b * b - 4 * a * c;
+    if(discriminant < 0) {
+        return std::nullopt;
+    }
+    float t = (-b - std::sqrt(discriminant)) / (2 * a);
+    if(t < 0 || t > 1) {
+        return std::nullopt;
+    }
+    return Impact{t, glm::normalize(this->getObjNormalToWorld() * (objStart + t * dir))};
+}
+
+Heightfield::Heightfield(const glm::mat4& ctm, const SceneMaterial& material, int param1, int param2, const std::string& heightMap)
+    : TessellatedPrimitive(ctm, material, param1, param2, 1, 1) {
+    // The image is only needed to read the heights from, so it's freed once they're read
+    const QImage image = loadTextureImage(heightMap);
+    if(image.width() < 2 || image.height() < 2) {
+        // The image failed to load, so fall back to a flat surface
+        this->width = this->depth = 2;
+        this->heights = std::vector<float>(4, 0);
+    } else {
+        this->width = image.width();
+        this->depth = image.height();
+        this->heights.resize(this->width * this->depth);
+        for(int j = 0; j < this->depth; j++) {
+            for(int i = 0; i < this->width; i++) {
+                this->heights[j * this->width + i] = qGray(image.pixel(i, j)) / 255.0f;
+            }
+        }
+    }
+    this->calcCollisionShape();
+}
+
+// Measures the world-space length of each object-space unit axis
+void Heightfield::calcCollisionShape() {
+    for(int i = 0; i < 3; i++) {
+        this->axisScale[i] = glm::length(glm::vec3(this->objectToWorld[i]));
+    }
+}
+
+// Pixel (i, j) of the image lies at x = -0.5 + i / (width - 1) and z = 0.5 - j / (depth - 1), matching the UV coordinates
+float Heightfield::getHeight(float x, float z, glm::vec2& gradient) const {
+    float u = std::clamp((x + this->boundCoord) * (this->width - 1), 0.0f, (float) (this->width - 1));
+    float v = std::clamp((this->boundCoord - z) * (this->depth - 1), 0.0f, (float) (this->depth - 1));
+    int i = std::min((int) u, this->width - 2);
+    int j = std::min((int) v, this->depth - 2);
+    float fu = u - i, fv = v - j;
+
+    const float* row0 = &this->heights[j * this->width + i];
+    const float* row1 = row0 + this->width;
+    float h00 = row0[0], h10 = row0[1], h01 = row1[0], h11 = row1[1];
+    gradient.x = glm::mix(h10 - h00, h11 - h01, fv) * (this->width - 1);
+    gradient.y = -glm::mix(h01 - h00, h11 - h10, fu) * (this->depth - 1);
+    return glm::mix(glm::mix(h00, h10, fu), glm::mix(h01, h11, fu), fv) - this->boundCoord;
+}
+
+bool Heightfield::isInside(glm::vec3 objPoint) const {
+    if(std::abs(objPoint.x) > this->boundCoord || std::abs(objPoint.z) > this->boundCoord || objPoint.y < -this->boundCoord) {
+        return false;
+    }
+    glm::vec2 gradient;
+    return objPoint.y <= this->getHeight(objPoint.x, objPoint.z, gradient);
+}
+
+const void Heightfield::calcVertexData() {
+    this->vertexData.clear();
+    float tileWidth = 2 * this->boundCoord / this->param1;
+    float tileDepth = 2 * this->boundCoord / this->param2;
+    auto getVertex = [this](float x, float z) -> glm::vec3 {
+        glm::vec2 gradient;
+        return glm::vec3(x, this->getHeight(x, z, gradient), z);
+    };
+    // Normals are taken by central differences across the neighboring vertices, to smooth over the bilinear patches
+    auto getNormal = [this, tileWidth, tileDepth, &getVertex](glm::vec3 pos) -> glm::vec3 {
+        float dx = getVertex(pos.x + tileWidth, pos.z).y - getVertex(pos.x - tileWidth, pos.z).y;
+        float dz = getVertex(pos.x, pos.z + tileDepth).y - getVertex(pos.x, pos.z - tileDepth).y;
+        return glm::normalize(glm::vec3(-dx / (2 * tileWidth), 1, -dz / (2 * tileDepth)));
+    };
+    for(int i = 0; i < this->param1; i++) {
+        for(int j = 0; j < this->param2; j++) {
+            float x0 = -this->boundCoord + i * tileWidth, x1 = x0 + tileWidth;
+            float z0 = -this->boundCoord + j * tileDepth, z1 = z0 + tileDepth;
+            std::vector<glm::vec3> vertices = {
+                getVertex(x1, z1),
+                getVertex(x0, z1),
+                getVertex(x1, z0),
+                getVertex(x0, z0)
+            };
+            std::vector<glm::vec3> normals(vertices.size());
+            std::transform(vertices.begin(), vertices.end(), normals.begin(), getNormal);
+            std::vector<glm::vec2> uvs(vertices.size());
+            std::transform(vertices.begin(), vertices.end(), uvs.begin(), [this](glm::vec3 pos) -> glm::vec2 {
+                return glm::vec2(pos.x + this->boundCoord, this->boundCoord - pos.z);
+            });
+            this->makeTile(vertices, normals, uvs, false);
+        }
+    }
+}
+
+// Pushes the point out through the closest of the surface (approximated by its tangent plane) and the sides and bottom
+// of the solid, comparing their distances in world space
+const std::optional<glm::vec3> Heightfield::findIntersectionPoint(glm::vec3 point) {
+    glm::vec3 objPoint = this->getWorldToObject() * glm::vec4(point, 1);
+    if(std::abs(objPoint.x) > this->boundCoord || std::abs(objPoint.z) > this->boundCoord || objPoint.y < -this->boundCoord) {
+        return std::nullopt;
+    }
+    glm::vec2 gradient;
+    float height = this->getHeight(objPoint.x, objPoint.z, gradient);
+    if(objPoint.y > height) {
+        return std::nullopt;
+    }
+
+    // point is inside heightfield
+    glm::vec3 surfacePoint = this->objectToWorld * glm::vec4(objPoint.x, height, objPoint.z, 1);
+    glm::vec3 normal = glm::normalize(this->getObjNormalToWorld() * glm::vec3(-gradient.x, 1, -gradient.y));
+    float minDist = glm::dot(surfacePoint - point, normal);
+    glm::vec3 interPoint = point + minDist * normal;
+
+    glm::vec3 faceDist = (this->boundCoord - glm::abs(objPoint)) * this->axisScale;
+    faceDist.y = (objPoint.y + this->boundCoord) * this->axisScale.y;
+    for(int axis = 0; axis < 3; axis++) {
+        if(faceDist[axis] < minDist) {
+            minDist = faceDist[axis];
+            glm::vec3 objInterPoint = objPoint;
+            objInterPoint[axis] = axis == 1 || objPoint[axis] < 0 ? -this->boundCoord : this->boundCoord;
+            interPoint = this->objectToWorld * glm::vec4(objInterPoint, 1);
+        }
+    }
+    return interPoint;
+}
+
+// Marches along the part of the segment within the heightfield's box, in steps no longer than a pixel, up to the first point
+// inside the solid; the crossing of the surface is then refined by bisection
+const std::optional<Impact> Heightfield::findTimeOfImpact(glm::vec3 start, glm::vec3 end) {
+    glm::vec3 objStart = this->getWorldToObject() * glm::vec4(start, 1);
+    glm::vec3 objEnd = this->getWorldToObject() * glm::vec4(end, 1);
+    glm::vec3 dir = objEnd - objStart;
+    if(this->isInside(objStart)) {
+        return std::nullopt;
+    }
+
+    float tEnter, tExit;
+    glm::vec3 objNormal;
+    if(!clipToBox(objStart, dir, this->boundCoord, tEnter, tExit, objNormal)) {
+        return std::nullopt;
+    }
+    if(this->isInside(objStart + tEnter * dir)) {
+        // Entered through a side (or the bottom) of the solid
+        return Impact{tEnter, glm::normalize(this->getObjNormalToWorld() * objNormal)};
+    }
+
+    float pixels = std::max(std::abs(dir.x) * (this->width - 1), std::abs(dir.z) * (this->depth - 1)) * (tExit - tEnter);
+    int steps = std::clamp((int) std::ceil(pixels), 1, this->maxMarchSteps);
+    float tOut = tEnter;
+    for(int step = 1; step <= steps; step++) {
+        float tIn = tEnter + (tExit - tEnter) * step / steps;
+        if(!this->isInside(objStart + tIn * dir)) {
+            tOut = tIn;
+            continue;
+        }
+        for(int iter = 0; iter < 10; iter++) {
+            float tMid = 0.5f * (tOut + tIn);
+            (this->isInside(objStart + tMid * dir) ? tIn : tOut) = tMid;
+        }
+        glm::vec3 objPoint = objStart + tIn * dir;
+        glm::vec2 gradient;
+        this->getHeight(objPoint.x, objPoint.z, gradient);
+        return Impact{tIn, glm::normalize(this->getObjNormalToWorld() * glm::vec3(-gradient.x, 1, -gradient.y))};
+    }
+    return std::nullopt;
+}
+
+Mesh::Mesh(const glm::mat4& ctm, const SceneMaterial& material, const std::string& meshfile) : Primitive(ctm, material) {
+    this->loaded = ObjLoader::load(meshfile, this->mesh);
+    if(this->loaded) {
+        this->bvh.build(this->mesh.positions, this->mesh.positionInds);
+        this->setObjectBounds(this->bvh.getBoundsMin(), this->bvh.getBoundsMax());
+    }
+}
+
+// Uses the file's normals and UV coordinates where given, and otherwise the triangle's face normal, and zero UV coordinates
+const void Mesh::calcVertexData() {
+    this->vertexData.clear();
+    this->vertexData.reserve(8 * this->mesh.positionInds.size());
+    for(size_t t = 0; t < this->mesh.numTriangles(); t++) {
+        const int* positionInds = &this->mesh.positionInds[3 * t];
+        glm::vec3 faceNormal = glm::normalize(glm::cross(this->mesh.positions[positionInds[1]] - this->mesh.positions[positionInds[0]],
+                                                         this->mesh.positions[positionInds[2]] - this->mesh.positions[positionInds[0]]));
+        for(size_t corner = 3 * t; corner < 3 * t + 3; corner++) {
+            int uvInd = this->mesh.uvInds[corner], normalInd = this->mesh.normalInds[corner];
+            insertVec(this->vertexData, this->mesh.positions[this->mesh.positionInds[corner]]);
+            insertVec(this->vertexData, normalInd >= 0 ? this->mesh.normals[normalInd] : faceNormal);
+            SceneFileMap& texture = this->material.textureMap;
+            insertVec(this->vertexData, (uvInd >= 0 ? this->mesh.uvs[uvInd] : glm::vec2(0)) * glm::vec2(texture.repeatU, texture.repeatV));
+        }
+    }
+}
+
+// The closest point is found in object space, so that it is only exactly the closest in world space under uniform scaling
+const std::optional<glm::vec3> Mesh::findIntersectionPoint(glm::vec3 point) {
+    if(!this->loaded) {
+        return std::nullopt;
+    }
+    glm::vec3 objPoint = this->getWorldToObject() * glm::vec4(point, 1);
+    if(glm::any(glm::lessThan(objPoint, this->bvh.getBoundsMin())) || glm::any(glm::greaterThan(objPoint, this->bvh.getBoundsMax())) ||
+       !this->bvh.isInside(objPoint)) {
+        return std::nullopt;
+    }
+    // point is inside mesh
+    return glm::vec3(this->objectToWorld * glm::vec4(this->bvh.findClosestPoint(objPoint), 1));
+}
+
+const std::optional<Impact> Mesh::findTimeOfImpact(glm::vec3 start, glm::vec3 end) {
+    if(!this->loaded) {
+        return std::nullopt;
+    }
+    glm::vec3 objStart = this->getWorldToObject() * glm::vec4(start, 1);
+    glm::vec3 objEnd = this->getWorldToObject() * glm::vec4(end, 1);
+    // Most segments cross nothing, so look for a crossing before checking the (costlier) case of starting inside
+    std::optional<TriangleHit> hit = this->bvh.findFirstHit(objStart, objEnd - objStart);
+    if(!hit || this->bvh.isInside(objStart)) {
+        return std::nullopt;
+    }
+    return Impact{hit->time, glm::normalize(this->getObjNormalToWorld() * hit->normal)};
+}
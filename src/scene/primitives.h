@@ -2,13 +2,19 @@
 #define PRIMITIVES_H
 
 #include <functional>
+#include <memory>
+#include <span>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <GL/glew.h>
-#include <QImage>
 #include "utils/scenedata.h"
+#include "utils/objloader.h"
 #include "utils/debug.h"
+#include "utils/shaderuniforms.h"
+#include "bvh.h"
+#include "texturecache.h"
 
 // ----------------------------------------------------------------------------------------------------------
 // Types used for tessellation and texturing
@@ -20,8 +26,91 @@ typedef std::function<glm::vec3(glm::vec3)> getNormalFunc;
 typedef std::function<glm::vec2(float, float, float)> getUVFunc;
 typedef std::function<glm::vec2(glm::vec3)> getUVCartFunc;
 
-// Caches a map from filenames to textures, initialized in scene.cpp
-extern std::unordered_map<std::string, QImage> fileToTexture;
+// ----------------------------------------------------------------------------------------------------------
+// Types used for batched collision queries
+
+// A structure-of-arrays view over a batch of world-space points
+struct PointBatch {
+    std::span<const double> x, y, z;
+};
+
+// A structure-of-arrays view over the results of a batched intersection query;
+// for each point i, hit[i] is nonzero iff the point lies inside the primitive,
+// in which case (x[i], y[i], z[i]) holds its closest point of intersection
+struct IntersectionBatch {
+    std::span<double> x, y, z;
+    std::span<uint8_t> hit;
+};
+
+// The first point at which a moving point enters a primitive, given by the fraction of its motion covered
+// before the impact, and the primitive's world-space unit surface normal at that point
+struct Impact {
+    float time;
+    glm::vec3 normal;
+};
+
+// ----------------------------------------------------------------------------------------------------------
+// Types used for kinematic animation
+
+// A keyframe of a primitive's animation: its transformation at the given time (in seconds), decomposed into
+// a translation, rotation and scale, which are interpolated separately between keyframes
+struct Keyframe {
+    float time;
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+
+// ----------------------------------------------------------------------------------------------------------
+// Packed collision shapes, precomputed from a primitive's transformation so that collision queries
+// can work directly in world space, rather than transforming each point through a general matrix
+
+// An oriented box, given by its center, unit axes and half-extents along each axis
+struct OrientedBox {
+    glm::vec3 center;
+    glm::vec3 axes[3];
+    glm::vec3 halfExtents;
+};
+
+// An ellipsoid, given by its center, unit axes and radii along each axis
+struct Ellipsoid {
+    glm::vec3 center;
+    glm::vec3 axes[3];
+    glm::vec3 radii;
+    int minAxis; // index of the axis with the smallest radius
+};
+
+// ----------------------------------------------------------------------------------------------------------
+// Types used for sharing geometry between primitives
+
+// Identifies primitives whose tessellations are identical (their UV coordinates are scaled by their textures' repeats)
+struct GeometryKey {
+    PrimitiveType type;
+    int param1, param2;
+    bool inverted;
+    float repeatU, repeatV;
+
+    auto operator<=>(const GeometryKey& other) const = default;
+};
+
+// The uploaded vertex data of a tessellation shared by all primitives of the same shape; its buffers
+// are deleted along with the last primitive using them
+struct SharedGeometry {
+    GLuint vbo = 0, vao = 0;
+    GLsizei numVertices = 0;
+
+    ~SharedGeometry() {
+        glErrorCheck(glDeleteBuffers(1, &this->vbo));
+        glErrorCheck(glDeleteVertexArrays(1, &this->vao));
+    }
+};
+
+// Checks whether two materials pass the same uniforms; primitives with the same texture file have identical textures
+inline bool sameMaterial(const SceneMaterial& a, const SceneMaterial& b) {
+    return a.cAmbient == b.cAmbient && a.cDiffuse == b.cDiffuse && a.cSpecular == b.cSpecular &&
+           a.shininess == b.shininess && a.blend == b.blend && a.textureMap.isUsed == b.textureMap.isUsed &&
+           (!a.textureMap.isUsed || a.textureMap.filename == b.textureMap.filename);
+}
 
 // ----------------------------------------------------------------------------------------------------------
 // Primitive class
@@ -31,10 +120,11 @@ class Primitive {
 public:
     Primitive(const glm::mat4&ctm, const SceneMaterial& material) {
         this->objectToWorld = ctm;
-        this->worldToObject = glm::inverse(ctm);
-        this->objNormalToWorld = glm::inverse(glm::transpose(glm::mat3(this->objectToWorld)));
+        this->prevObjectToWorld = ctm;
         this->material = material;
         this->vertexData = std::vector<float>();
+        this->calcBoundingSphere();
+        this->prevBoundsCenter = this->boundsCenter;
     }
 
     // Constructs a primitive with manually specified vertex data
@@ -43,23 +133,195 @@ public:
         this->vertexData = vertexData;
     }
 
-    // Frees any underlying memory for used OpenGL objects
+    // Frees any underlying memory for used OpenGL objects (shared geometry and textures are freed by their last user)
     virtual ~Primitive() {
-        glErrorCheck(glDeleteBuffers(1, &this->vbo));
-        glErrorCheck(glDeleteVertexArrays(1, &this->vao));
-        glErrorCheck(glDeleteTextures(1, &this->texture));
+        if(this->geometry == nullptr) {
+            glErrorCheck(glDeleteBuffers(1, &this->vbo));
+            glErrorCheck(glDeleteVertexArrays(1, &this->vao));
+        }
     }
 
     // Initializes any OpenGL-related objects for the primitive
     const inline void initialize() {
-        // Generate vertex data
-        calcVertexData();
+        // Reuse the buffers of an identical shape if there are any; otherwise generate vertex data,
+        // and upload it into new VBO and VAO objects
+        std::optional<GeometryKey> key = this->getGeometryKey();
+        if(key && this->findSharedGeometry(*key)) {
+            this->vbo = this->geometry->vbo;
+            this->vao = this->geometry->vao;
+            this->numVertices = this->geometry->numVertices;
+        } else {
+            calcVertexData();
+
+            glErrorCheck(glGenBuffers(1, &this->vbo));
+            glErrorCheck(glGenVertexArrays(1, &this->vao));
+
+            this->initializeBuffers();
+            if(key) {
+                this->shareGeometry(*key);
+            }
+        }
+
+        // Share the texture of any other primitive with the same texture file, if textured
+        SceneFileMap& textureMap = this->material.textureMap;
+        if(textureMap.isUsed) {
+            this->texture = acquireTexture(textureMap.filename);
+        }
+    }
+
+    // Calculates the vertex data of the given primitive, according to its shape parameters
+    const virtual void calcVertexData() {}
+
+    // Finds the closest point of intersection with the primitive for the given point,
+    // if the point lies inside the primitive (otherwise returning none)
+    const virtual std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) {
+        return std::nullopt;
+    }
+
+    // Finds the closest points of intersection for a whole batch of points in one call,
+    // writing the results into the given output batch (which must be at least as large).
+    // By default, falls back to calling findIntersectionPoint on each point.
+    const virtual void findIntersectionPoints(const PointBatch& points, IntersectionBatch& out) {
+        for(size_t i = 0; i < points.x.size(); i++) {
+            std::optional<glm::vec3> interPoint = this->findIntersectionPoint(glm::vec3(points.x[i], points.y[i], points.z[i]));
+            out.hit[i] = interPoint.has_value();
+            if(interPoint) {
+                out.x[i] = interPoint->x;
+                out.y[i] = interPoint->y;
+                out.z[i] = interPoint->z;
+            }
+        }
+    }
+
+    // Finds where a point moving in a straight line from start to end first enters the primitive, if it does;
+    // a point starting inside the primitive is left to findIntersectionPoint instead. Affine transformations
+    // preserve the fraction of the motion covered, so the test can run in object space.
+    const virtual std::optional<Impact> findTimeOfImpact(glm::vec3 start, glm::vec3 end) {
+        return std::nullopt;
+    }
+
+    // Moves the primitive to the given transformation, reached dt seconds after its last one. Only the collision
+    // shape and bounding sphere are refitted right away; the inverse transformations are recomputed on first use.
+    void setTransform(const glm::mat4& ctm, float dt) {
+        this->prevObjectToWorld = this->objectToWorld;
+        this->prevBoundsCenter = this->boundsCenter;
+        this->moving = ctm != this->objectToWorld;
+        if(!this->moving) {
+            return;
+        }
+        this->objectToWorld = ctm;
+        this->transformDt = dt;
+        this->inverseStale = true;
+        this->calcBoundingSphere();
+        this->calcCollisionShape();
+    }
+
+    // Keyframed animation, looping once the time passes the last keyframe
+    void setKeyframes(const std::vector<Keyframe>& keyframes) {
+        this->keyframes = keyframes;
+    }
+    void animate(float time, float dt);
+
+    // Whether the primitive's transformation changed at its last update
+    bool isMoving() const {
+        return this->moving;
+    }
+    // Returns the world-space velocity of the point of the primitive at the given world-space position, due to its last update
+    glm::vec3 getVelocity(glm::vec3 point) const {
+        if(!this->moving) {
+            return glm::vec3(0);
+        }
+        glm::vec4 prevPoint = this->prevObjectToWorld * (this->getWorldToObject() * glm::vec4(point, 1));
+        return (point - glm::vec3(prevPoint)) / this->transformDt;
+    }
+    // Returns how far the center of the bounding sphere moved at the last update
+    glm::vec3 getBoundsDisplacement() const {
+        return this->boundsCenter - this->prevBoundsCenter;
+    }
+
+    // Returns the center and radius of a world-space sphere enclosing the primitive
+    const glm::vec3& getBoundsCenter() const {
+        return this->boundsCenter;
+    }
+    const float getBoundsRadius() const {
+        return this->boundsRadius;
+    }
+
+    // Drawing is split into its pieces of state, so that the render queue can skip those already bound: the primitive's VAO and
+    // texture (bound to texture slot 0) are bound by the caller, and its material and transformation passed as uniforms, before
+    // drawing its geometry
+
+    // Passes the primitive's transformation to the given shader
+    const inline void bindTransform(const ShaderUniforms& shader) const {
+        glErrorCheck(glUniformMatrix4fv(shader.modelMat, 1, false, &this->objectToWorld[0][0]));
+        glErrorCheck(glUniformMatrix3fv(shader.normalMat, 1, false, &this->getObjNormalToWorld()[0][0]));
+    }
+
+    // Passes the primitive's material properties to the given shader
+    const inline void bindMaterial(const ShaderUniforms& shader) const {
+        // Pass material properties as a uniform
+        glErrorCheck(glUniform4fv(shader.materialAmbient, 1, &this->material.cAmbient[0]));
+        glErrorCheck(glUniform4fv(shader.materialDiffuse, 1, &this->material.cDiffuse[0]));
+        glErrorCheck(glUniform4fv(shader.materialSpecular, 1, &this->material.cSpecular[0]));
+        glErrorCheck(glUniform1f(shader.materialShininess, this->material.shininess));
+
+        // Pass texture properties as a uniform
+        glErrorCheck(glUniform1i(shader.textured, this->material.textureMap.isUsed));
+        glErrorCheck(glUniform1f(shader.materialBlend, this->material.blend));
+    }
 
-        // Generate VBO and VAO objects and texture
-        glErrorCheck(glGenBuffers(1, &this->vbo));
-        glErrorCheck(glGenVertexArrays(1, &this->vao));
-        glErrorCheck(glGenTextures(1, &this->texture));
+    // Draws the vertices of the primitive's VAO, which must be bound, with the given shader
+    const virtual void drawGeometry(const ShaderUniforms& shader) const {
+        glErrorCheck(glDrawArrays(GL_TRIANGLES, 0, this->numVertices));
+    }
+
+    GLuint getVao() const {
+        return this->vao;
+    }
+    // Returns the primitive's texture, or 0 if it isn't textured
+    GLuint getTexture() const {
+        return this->texture ? this->texture->texture : 0;
+    }
+
+    // Returns the geometry the primitive shares with identical primitives, if any
+    const SharedGeometry* getSharedGeometry() const {
+        return this->geometry.get();
+    }
+    const SceneMaterial& getMaterial() const {
+        return this->material;
+    }
+    // Writes the primitive's model matrix, then its normal matrix (16 and 9 floats), for drawing it as an instance
+    void writeInstanceData(GLfloat* data) const {
+        std::copy_n(&this->objectToWorld[0][0], 16, data);
+        std::copy_n(&this->getObjNormalToWorld()[0][0], 9, data + 16);
+    }
+
+protected:
+    glm::mat4 objectToWorld;
+    SceneMaterial material;
+
+    // Inverse transformations, recomputed lazily whenever the transformation has changed
+    const glm::mat4& getWorldToObject() const {
+        this->updateInverse();
+        return this->worldToObject;
+    }
+    const glm::mat3& getObjNormalToWorld() const {
+        this->updateInverse();
+        return this->objNormalToWorld;
+    }
+
+    // Recomputes any world-space collision shape, after the transformation has changed
+    virtual void calcCollisionShape() {}
+
+    // Returns the key under which the primitive's uploaded geometry can be shared with identical primitives,
+    // or none if it can't be shared (by default, as its vertex data may be unique)
+    virtual std::optional<GeometryKey> getGeometryKey() const {
+        return std::nullopt;
+    }
 
+    // Uploads the vertex data and describes its layout to the VAO; by default, as interleaved positions,
+    // normals and UV coordinates, drawn as unindexed triangles, after which the CPU copy is freed
+    const virtual void initializeBuffers() {
         // Bind VBO
         glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->vbo));
         glErrorCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * this->vertexData.size(), this->vertexData.data(), GL_STATIC_DRAW));
@@ -81,63 +343,78 @@ public:
         glErrorCheck(glBindVertexArray(0));
         glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-        // Initialize texture, if textured
-        SceneFileMap& textureMap = this->material.textureMap;
-        if(textureMap.isUsed) {
-            glErrorCheck(glActiveTexture(GL_TEXTURE0));
-            glErrorCheck(glBindTexture(GL_TEXTURE_2D, this->texture));
-            QImage& textureImage = fileToTexture[textureMap.filename];
-            glErrorCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureImage.width(), textureImage.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImage.bits()));
-            glErrorCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-            glErrorCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-            glErrorCheck(glBindTexture(GL_TEXTURE_2D, 0));
-        }
+        this->numVertices = this->vertexData.size() / 8;
+        std::vector<GLfloat>().swap(this->vertexData);
     }
 
-    // Calculates the vertex data of the given primitive, according to its shape parameters
-    const virtual void calcVertexData() {}
-
-    // Finds the closest point of intersection with the primitive for the given point,
-    // if the point lies inside the primitive (otherwise returning none)
-    const virtual std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) {
-        return std::nullopt;
+    GLuint vbo, vao;
+    std::shared_ptr<SharedTexture> texture; // if textured
+    std::vector<GLfloat> vertexData;
+    GLsizei numVertices = 0; // number of vertices uploaded by the default initializeBuffers
+
+    // World-space bounding sphere, used for broad-phase collision culling
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+
+    // Extracts the world-space center, unit axes and scale along each axis of the primitive's
+    // transformation; returns false if the transformation shears (i.e. the axes aren't orthogonal)
+    bool calcFrame(glm::vec3& center, glm::vec3 (&axes)[3], glm::vec3& scale) const {
+        center = this->objectToWorld[3];
+        for(int i = 0; i < 3; i++) {
+            scale[i] = glm::length(glm::vec3(this->objectToWorld[i]));
+            axes[i] = glm::vec3(this->objectToWorld[i]) / scale[i];
+        }
+        const float tolerance = 1e-4f;
+        return std::abs(glm::dot(axes[0], axes[1])) < tolerance &&
+               std::abs(glm::dot(axes[1], axes[2])) < tolerance &&
+               std::abs(glm::dot(axes[0], axes[2])) < tolerance;
     }
 
-    // Draws the given primitive
-    const inline void draw(GLuint shader) const {
-        // Bind any uniform variables associated with this primitive
-        glErrorCheck(glUniformMatrix4fv(glGetUniformLocation(shader, "modelMat"), 1, false, &this->objectToWorld[0][0]));
-        glErrorCheck(glUniformMatrix3fv(glGetUniformLocation(shader, "normalMat"), 1, false, &this->objNormalToWorld[0][0]));
-
-        // Pass material properties as a uniform
-        glErrorCheck(glUniform4fv(glGetUniformLocation(shader, "materialAmbient"), 1, &this->material.cAmbient[0]));
-        glErrorCheck(glUniform4fv(glGetUniformLocation(shader, "materialDiffuse"), 1, &this->material.cDiffuse[0]));
-        glErrorCheck(glUniform4fv(glGetUniformLocation(shader, "materialSpecular"), 1, &this->material.cSpecular[0]));
-        glErrorCheck(glUniform1f(glGetUniformLocation(shader, "materialShininess"), this->material.shininess));
-
-        // Pass texture properties as a uniform
-        glErrorCheck(glUniform1i(glGetUniformLocation(shader, "textured"), this->material.textureMap.isUsed));
-        glErrorCheck(glActiveTexture(GL_TEXTURE0));
-        glErrorCheck(glBindTexture(GL_TEXTURE_2D, this->texture));
-        glErrorCheck(glUniform1f(glGetUniformLocation(shader, "materialBlend"), this->material.blend));
-
-        // Bind VAO and draw associated vertices
-        glErrorCheck(glBindVertexArray(this->vao));
-
-        glErrorCheck(glDrawArrays(GL_TRIANGLES, 0, this->vertexData.size() / 8));
+    // Calculates the bounding sphere of the object-space bounding box (by default, the unit cube, which encloses all of the
+    // tessellated primitives) under the primitive's transformation
+    void calcBoundingSphere() {
+        glm::vec3 halfExtents = 0.5f * (this->objBoundsMax - this->objBoundsMin);
+        this->boundsCenter = this->objectToWorld * glm::vec4(0.5f * (this->objBoundsMin + this->objBoundsMax), 1);
+        glm::vec3 axisX = glm::vec3(this->objectToWorld[0]) * halfExtents.x;
+        glm::vec3 axisY = glm::vec3(this->objectToWorld[1]) * halfExtents.y;
+        glm::vec3 axisZ = glm::vec3(this->objectToWorld[2]) * halfExtents.z;
+        this->boundsRadius = std::max(std::max(glm::length( axisX + axisY + axisZ), glm::length(-axisX + axisY + axisZ)),
+                                      std::max(glm::length(-axisX - axisY + axisZ), glm::length( axisX - axisY + axisZ)));
+    }
 
-        glErrorCheck(glBindVertexArray(0));
-        glErrorCheck(glBindTexture(GL_TEXTURE_2D, 0));
+    // Replaces the object-space bounding box, for primitives not contained in the unit cube
+    void setObjectBounds(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+        this->objBoundsMin = boundsMin;
+        this->objBoundsMax = boundsMax;
+        this->calcBoundingSphere();
+        this->prevBoundsCenter = this->boundsCenter;
     }
 
-protected:
-    glm::mat4 objectToWorld;
-    glm::mat4 worldToObject;
-    glm::mat3 objNormalToWorld;
-    SceneMaterial material;
+private:
+    glm::vec3 objBoundsMin = glm::vec3(-0.5f), objBoundsMax = glm::vec3(0.5f);
+
+    // Geometry shared with identical primitives, if any; the cache of shared geometry only holds weak references to it
+    std::shared_ptr<SharedGeometry> geometry;
+    bool findSharedGeometry(const GeometryKey& key);
+    void shareGeometry(const GeometryKey& key);
+
+    mutable glm::mat4 worldToObject;
+    mutable glm::mat3 objNormalToWorld;
+    mutable bool inverseStale = true;
+    void updateInverse() const {
+        if(this->inverseStale) {
+            this->worldToObject = glm::inverse(this->objectToWorld);
+            this->objNormalToWorld = glm::inverse(glm::transpose(glm::mat3(this->objectToWorld)));
+            this->inverseStale = false;
+        }
+    }
 
-    GLuint vbo, vao, texture;
-    std::vector<GLfloat> vertexData;
+    // Kinematic state: the transformation before the last update, and the time it took
+    glm::mat4 prevObjectToWorld;
+    glm::vec3 prevBoundsCenter;
+    float transformDt = 1;
+    bool moving = false;
+    std::vector<Keyframe> keyframes;
 };
 
 // ----------------------------------------------------------------------------------------------------------
@@ -177,10 +454,13 @@ public:
     Cube(const glm::mat4& ctm, const SceneMaterial& material, int param, bool inverted)
         : TessellatedPrimitive(ctm, material, param, param, 1, 1) {
         this->inverted = inverted;
+        this->calcCollisionShape();
     }
 
     const void calcVertexData() override;
     const std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) override;
+    const void findIntersectionPoints(const PointBatch& points, IntersectionBatch& out) override;
+    const std::optional<Impact> findTimeOfImpact(glm::vec3 start, glm::vec3 end) override;
 protected:
     const void makeFace(glm::vec3 topLeft, glm::vec3 topRight,
                         glm::vec3 bottomLeft, glm::vec3 bottomRight,
@@ -188,18 +468,43 @@ protected:
 
     const float boundCoord = 0.5f;
     bool inverted;
+
+    std::optional<GeometryKey> getGeometryKey() const override {
+        const SceneFileMap& texture = this->material.textureMap;
+        return GeometryKey{PrimitiveType::PRIMITIVE_CUBE, this->param1, this->param2, this->inverted, texture.repeatU, texture.repeatV};
+    }
+
+    // The cube as an oriented box in world space, if its transformation doesn't shear
+    OrientedBox box;
+    bool hasBox;
+    void calcCollisionShape() override;
 };
 
 // A sphere centered at the origin, with a diameter of 1
 class Sphere : public TessellatedPrimitive {
 public:
     Sphere(const glm::mat4& ctm, const SceneMaterial& material, int param1, int param2)
-        : TessellatedPrimitive(ctm, material, param1, param2, 2, 3) {}
+        : TessellatedPrimitive(ctm, material, param1, param2, 2, 3) {
+        this->calcCollisionShape();
+    }
 
     const void calcVertexData() override;
     const std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) override;
+    const void findIntersectionPoints(const PointBatch& points, IntersectionBatch& out) override;
+    const std::optional<Impact> findTimeOfImpact(glm::vec3 start, glm::vec3 end) override;
 private:
     const float radius = 0.5f;
+
+    std::optional<GeometryKey> getGeometryKey() const override {
+        const SceneFileMap& texture = this->material.textureMap;
+        return GeometryKey{PrimitiveType::PRIMITIVE_SPHERE, this->param1, this->param2, false, texture.repeatU, texture.repeatV};
+    }
+
+    // The sphere as an ellipsoid in world space, if its transformation doesn't shear
+    Ellipsoid ellipsoid;
+    bool hasEllipsoid;
+    void calcCollisionShape() override;
+
     const getNormalFunc getSphereNormal = [](glm::vec3 pos) -> glm::vec3 {
         return pos;
     };
@@ -208,4 +513,50 @@ private:
     };
 };
 
+// A heightfield terrain; a solid spanning [-0.5, 0.5] along x and z, from y = -0.5 up to its surface, whose height
+// rises from -0.5 to 0.5 with the brightness of the given grayscale image. Collision queries look up the height and
+// normal under a point by bilinear interpolation between the image's pixels, in constant time.
+class Heightfield : public TessellatedPrimitive {
+public:
+    Heightfield(const glm::mat4& ctm, const SceneMaterial& material, int param1, int param2, const std::string& heightMap);
+
+    const void calcVertexData() override;
+    const std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) override;
+    const std::optional<Impact> findTimeOfImpact(glm::vec3 start, glm::vec3 end) override;
+private:
+    const float boundCoord = 0.5f;
+
+    // Heights of the image's pixels (from 0 to 1), in row-major order
+    std::vector<float> heights;
+    int width, depth;
+
+    // Interpolates the object-space height of the surface at the given object-space x and z, along with its gradient
+    float getHeight(float x, float z, glm::vec2& gradient) const;
+    // Checks whether an object-space point lies inside the solid
+    bool isInside(glm::vec3 objPoint) const;
+
+    // World-space length of each object-space unit axis, for comparing distances to the faces
+    glm::vec3 axisScale;
+    const int maxMarchSteps = 64; // cap on the steps taken along a swept segment
+    void calcCollisionShape() override;
+};
+
+// -----------------------------------------------------------------------------
+// Inheritors of the Primitive abstract class
+
+// A triangle mesh loaded from an OBJ file. For collisions, the mesh is treated as a closed solid,
+// and queried through a bounding volume hierarchy over its triangles.
+class Mesh : public Primitive {
+public:
+    Mesh(const glm::mat4& ctm, const SceneMaterial& material, const std::string& meshfile);
+
+    const void calcVertexData() override;
+    const std::optional<glm::vec3> findIntersectionPoint(glm::vec3 point) override;
+    const std::optional<Impact> findTimeOfImpact(glm::vec3 start, glm::vec3 end) override;
+private:
+    MeshData mesh;
+    TriangleBVH bvh;
+    bool loaded;
+};
+
 #endif // PRIMITIVES_H
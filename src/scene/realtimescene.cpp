@@ -3,10 +3,10 @@
 #include "utils/sceneparser.h"
 #include "settings.h"
 #include "jellocube.h"
-#include <unordered_map>
 #include <span>
-
-std::unordered_map<std::string, QImage> fileToTexture;
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 RealtimeScene::RealtimeScene() {
     this->scenefile = "";
@@ -20,18 +20,8 @@ RealtimeScene::RealtimeScene() {
 void RealtimeScene::initScene() {
     RenderData renderData;
     SceneParser::parse("scenefile.json", renderData);
-
-    fileToTexture.clear();
-    for(const RenderShapeData& shapeData : renderData.shapes) {
-        const SceneFileMap& textureMap = shapeData.primitive.material.textureMap;
-        if(textureMap.isUsed && !fileToTexture.contains(textureMap.filename)) {
-            fileToTexture[textureMap.filename] = QImage(textureMap.filename.c_str()).convertToFormat(QImage::Format_RGBA8888).mirrored();
-        }
-    }
-    SceneFileMap& obstacleTexture = this->obstacleMaterial.textureMap;
-    if(obstacleTexture.isUsed && !fileToTexture.contains(obstacleTexture.filename)) {
-        fileToTexture[obstacleTexture.filename] = QImage(obstacleTexture.filename.c_str()).convertToFormat(QImage::Format_RGBA8888).mirrored();
-    }
+    this->jelloMeshFile = renderData.jelloMeshFile;
+    this->jelloRenderMesh = nullptr;
 
     RenderShapeData& shapeData = renderData.shapes[0];
     settings.bounds = 4;
@@ -43,9 +33,18 @@ void RealtimeScene::initScene() {
     boundingBox->initialize();
     this->primitives.push_back(std::move(boundingBox));
 
-    std::unique_ptr<Primitive> jelloCube = std::make_unique<JelloCube>(getJelloMaterial(), 8, glm::vec3(0, settings.bounds - 1, 0));
-    jelloCube->initialize();
-    this->primitives.push_back(std::move(jelloCube));
+    // Any meshes in the scene file become obstacles, which are kept when the scene is reset
+    this->numSceneObstacles = 0;
+    for(const RenderShapeData& meshData : renderData.shapes) {
+        if(meshData.primitive.type == PrimitiveType::PRIMITIVE_MESH) {
+            std::unique_ptr<Primitive> mesh = std::make_unique<Mesh>(meshData.ctm, meshData.primitive.material, meshData.primitive.meshfile);
+            mesh->initialize();
+            this->primitives.push_back(std::move(mesh));
+            this->numSceneObstacles++;
+        }
+    }
+
+    this->primitives.push_back(this->makeJelloCube(glm::vec3(0, settings.bounds - 1, 0)));
 
     this->camera.updateCamera(renderData.cameraData);
     this->globalData = renderData.globalData;
@@ -57,16 +56,59 @@ void RealtimeScene::initScene() {
 }
 
 void RealtimeScene::resetScene() {
-    this->primitives.erase(this->primitives.begin() + 1, this->primitives.end()); // erase all primitives except bounding box
-    std::unique_ptr<Primitive> jelloCube = std::make_unique<JelloCube>(getJelloMaterial(), 8, glm::vec3(0, settings.bounds - 1, 0));
-    jelloCube->initialize();
-    this->primitives.push_back(std::move(jelloCube));
+    // erase all primitives except the bounding box and the scene file's obstacles
+    this->primitives.erase(this->primitives.begin() + 1 + this->numSceneObstacles, this->primitives.end());
+    this->primitives.push_back(this->makeJelloCube(glm::vec3(0, settings.bounds - 1, 0)));
+}
+
+std::vector<std::unique_ptr<Primitive>>::iterator RealtimeScene::getFirstJelloCube() {
+    return std::find_if(this->primitives.begin() + 1, this->primitives.end(), [](std::unique_ptr<Primitive>& primitive) {
+        return dynamic_cast<JelloCube*>(primitive.get()) != nullptr;
+    });
+}
+
+std::span<std::unique_ptr<Primitive>> RealtimeScene::getJelloCubes() {
+    return std::span<std::unique_ptr<Primitive>>(this->getFirstJelloCube(), this->primitives.end());
 }
 
 void RealtimeScene::updateScene() {
-    std::span<std::unique_ptr<Primitive>> interPrimitives(this->primitives.begin() + 1, this->primitives.end() - 1);
-    if (JelloCube* jelloCube = dynamic_cast<JelloCube*>(this->primitives[this->primitives.size()-1].get())) {
-        jelloCube->update(interPrimitives);
+    auto firstCube = this->getFirstJelloCube();
+    std::span<std::unique_ptr<Primitive>> interPrimitives(this->primitives.begin() + 1, firstCube);
+
+    // All cubes and obstacles advance by the same timestep, so that the obstacles' motion matches the time the cubes integrate
+    // over (under automatic timesteps, the smallest timestep any cube needs to stay stable)
+    double dt = std::numeric_limits<double>::max();
+    for(auto cubeIt = firstCube; cubeIt != this->primitives.end(); cubeIt++) {
+        JelloCube* jelloCube = static_cast<JelloCube*>(cubeIt->get());
+        jelloCube->updateLOD(this->camera);
+        dt = std::min(dt, jelloCube->getTimestep());
+    }
+    if(firstCube == this->primitives.end()) {
+        dt = settings.dt / 1000.0;
+    }
+
+    // Move any animated obstacles first, so that the cubes collide with them in their new poses
+    this->time += dt;
+    for(std::unique_ptr<Primitive>& obstacle : interPrimitives) {
+        obstacle->animate(this->time, dt);
+    }
+
+    for(auto cubeIt = firstCube; cubeIt != this->primitives.end(); cubeIt++) {
+        JelloCube* jelloCube = static_cast<JelloCube*>(cubeIt->get());
+        // Sleeping cubes are woken up by a moving obstacle reaching them
+        for(int i = 0; jelloCube->isAsleep() && i < interPrimitives.size(); i++) {
+            if(interPrimitives[i]->isMoving() && jelloCube->overlaps(*interPrimitives[i])) {
+                jelloCube->wake();
+            }
+        }
+        // Sleeping cubes are woken up by contact with another, awake cube
+        for(auto otherIt = firstCube; jelloCube->isAsleep() && otherIt != this->primitives.end(); otherIt++) {
+            JelloCube* other = static_cast<JelloCube*>(otherIt->get());
+            if(other != jelloCube && !other->isAsleep() && jelloCube->overlaps(*other)) {
+                jelloCube->wake();
+            }
+        }
+        jelloCube->update(interPrimitives, dt);
     }
 }
 
@@ -98,59 +140,130 @@ void RealtimeScene::addObstacle() {
     else
         primitive = std::make_unique<Sphere>(ctm, this->obstacleMaterial, 25, 25);
     primitive->initialize();
-    this->primitives.insert(this->primitives.end() - 1, std::move(primitive));
+    this->primitives.insert(this->getFirstJelloCube(), std::move(primitive));
+
+    // Wake up any sleeping cubes, which the new obstacle may disturb
+    for(auto cubeIt = this->getFirstJelloCube(); cubeIt != this->primitives.end(); cubeIt++) {
+        static_cast<JelloCube*>(cubeIt->get())->wake();
+    }
 }
 
-void RealtimeScene::bindSceneUniforms(GLuint shader) {
-    // Camera data
-    glErrorCheck(glUniformMatrix4fv(glGetUniformLocation(shader, "viewMat"), 1, false, &this->camera.getViewMatrix()[0][0]));
-    glErrorCheck(glUniformMatrix4fv(glGetUniformLocation(shader, "projMat"), 1, false, &this->camera.getProjMatrix()[0][0]));
-    glErrorCheck(glUniform4fv(glGetUniformLocation(shader, "cameraPos"), 1, &this->camera.getPosition()[0]));
+void RealtimeScene::addMovingObstacle() {
+    glm::vec3 rotAxis = glm::normalize(glm::vec3(randFloat(-1, 1), randFloat(-1, 1), randFloat(-1, 1)));
+    glm::vec3 scale(randFloat(0.5, 1.5), randFloat(0.5, 1.5), randFloat(0.5, 1.5));
+    // limit translation to within bounding box
+    float maxTranslate = settings.bounds - glm::length(0.5f * scale);
 
-    // Global data
-    glErrorCheck(glUniform1f(glGetUniformLocation(shader, "ka"), this->globalData.ka));
-    glErrorCheck(glUniform1f(glGetUniformLocation(shader, "kd"), this->globalData.kd));
-    glErrorCheck(glUniform1f(glGetUniformLocation(shader, "ks"), this->globalData.ks));
+    // Loop around a triangle of random points, while making a full turn about the rotation axis
+    float period = randFloat(4, 8);
+    std::vector<Keyframe> keyframes;
+    for(int i = 0; i <= 3; i++) {
+        glm::vec3 translate = i < 3 ? glm::vec3(randFloat(-maxTranslate, maxTranslate), randFloat(-maxTranslate, maxTranslate), randFloat(-maxTranslate, maxTranslate))
+                                    : keyframes[0].translation;
+        keyframes.push_back({period * i / 3, translate, glm::angleAxis(2 * (float) M_PI * i / 3, rotAxis), scale});
+    }
+    glm::mat4 ctm = glm::scale(glm::translate(glm::mat4(1), keyframes[0].translation), scale);
+
+    std::unique_ptr<Primitive> primitive;
+    if(rand() % 2 == 0)
+        primitive = std::make_unique<Cube>(ctm, this->obstacleMaterial, 1, false);
+    else
+        primitive = std::make_unique<Sphere>(ctm, this->obstacleMaterial, 25, 25);
+    primitive->setKeyframes(keyframes);
+    primitive->initialize();
+    this->primitives.insert(this->getFirstJelloCube(), std::move(primitive));
+}
+
+void RealtimeScene::addTerrain() {
+    // Cover the floor of the bounding box with rolling terrain
+    float height = 0.4f * settings.bounds;
+    glm::mat4 ctm = glm::scale(glm::translate(glm::mat4(1), glm::vec3(0, 0.5f * height - settings.bounds, 0)),
+                               glm::vec3(2 * settings.bounds, height, 2 * settings.bounds));
+    std::unique_ptr<Primitive> terrain = std::make_unique<Heightfield>(ctm, this->obstacleMaterial, 64, 64, "textures/terrain.png");
+    terrain->initialize();
+    this->primitives.insert(this->getFirstJelloCube(), std::move(terrain));
+
+    // Wake up any sleeping cubes, which the terrain may disturb
+    for(auto cubeIt = this->getFirstJelloCube(); cubeIt != this->primitives.end(); cubeIt++) {
+        static_cast<JelloCube*>(cubeIt->get())->wake();
+    }
+}
+
+void RealtimeScene::addJelloCube() {
+    // limit position to within bounding box
+    float maxTranslate = settings.bounds - 1;
+    glm::vec3 center(randFloat(-maxTranslate, maxTranslate), randFloat(-maxTranslate, maxTranslate), randFloat(-maxTranslate, maxTranslate));
+
+    this->primitives.push_back(this->makeJelloCube(center));
+}
+
+std::unique_ptr<Primitive> RealtimeScene::makeJelloCube(glm::vec3 center) {
+    if(this->jelloRenderMesh == nullptr) {
+        MeshData meshData;
+        if(!this->jelloMeshFile.empty() && ObjLoader::load(this->jelloMeshFile, meshData) && meshData.numTriangles() > 0) {
+            this->jelloRenderMesh = RenderMesh::fromMeshData(meshData);
+        } else {
+            this->jelloRenderMesh = RenderMesh::subdividedCube(this->jelloRenderResolution);
+        }
+    }
+    std::unique_ptr<JelloCube> jelloCube = std::make_unique<JelloCube>(getJelloMaterial(), 8, center);
+    jelloCube->setRenderMesh(this->jelloRenderMesh);
+    jelloCube->initialize();
+    return jelloCube;
+}
+
+void RealtimeScene::updateSceneUniforms() {
+    if(this->frameUbo == 0) {
+        // Binding points are global state, so the buffers only need binding once
+        glErrorCheck(glGenBuffers(1, &this->frameUbo));
+        glErrorCheck(glBindBuffer(GL_UNIFORM_BUFFER, this->frameUbo));
+        glErrorCheck(glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW));
+        glErrorCheck(glBindBufferBase(GL_UNIFORM_BUFFER, frameBlockBinding, this->frameUbo));
+        glErrorCheck(glGenBuffers(1, &this->lightsUbo));
+        glErrorCheck(glBindBuffer(GL_UNIFORM_BUFFER, this->lightsUbo));
+        glErrorCheck(glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), nullptr, GL_DYNAMIC_DRAW));
+        glErrorCheck(glBindBufferBase(GL_UNIFORM_BUFFER, lightsBlockBinding, this->lightsUbo));
+        this->uniformsUploaded = false;
+    }
+
+    // Camera and global data; the blocks are value-initialized, so that their padding compares equal
+    FrameBlock frame = {};
+    frame.viewMat = this->camera.getViewMatrix();
+    frame.projMat = this->camera.getProjMatrix();
+    frame.cameraPos = this->camera.getPosition();
+    frame.ka = this->globalData.ka;
+    frame.kd = this->globalData.kd;
+    frame.ks = this->globalData.ks;
+    frame.textureMapEnabled = settings.textureMappingEnabled;
 
     // Light data
-    int i = 0;
-    for(SceneLightData lightData : this->lights) {
-        std::string entry = "lights[" + std::to_string(i) + "]";
-        glErrorCheck(glUniform1i(
-            glGetUniformLocation(shader, (entry + ".type").c_str()),
-            (GLint) lightData.type
-        ));
-        glErrorCheck(glUniform4fv(
-            glGetUniformLocation(shader, (entry + ".color").c_str()),
-            1, &lightData.color[0]
-        ));
-        glErrorCheck(glUniform3fv(
-            glGetUniformLocation(shader, (entry + ".function").c_str()),
-            1, &lightData.function[0]
-        ));
-        glErrorCheck(glUniform4fv(
-            glGetUniformLocation(shader, (entry + ".pos").c_str()),
-            1, &lightData.pos[0]
-        ));
-        glErrorCheck(glUniform4fv(
-            glGetUniformLocation(shader, (entry + ".dir").c_str()),
-            1, &lightData.dir[0]
-        ));
-        glErrorCheck(glUniform1f(
-            glGetUniformLocation(shader, (entry + ".penumbra").c_str()),
-            lightData.penumbra
-        ));
-        glErrorCheck(glUniform1f(
-            glGetUniformLocation(shader, (entry + ".angle").c_str()),
-            lightData.angle
-        ));
-        i++;
-
-        if(i == 8) {
+    LightsBlock lightBlocks = {};
+    for(const SceneLightData& lightData : this->lights) {
+        if(lightBlocks.numLights == maxLights) {
             break;
         }
+        LightBlock& light = lightBlocks.lights[lightBlocks.numLights++];
+        light.color = lightData.color;
+        light.pos = lightData.pos;
+        light.dir = lightData.dir;
+        light.function = lightData.function;
+        light.type = (GLint) lightData.type;
+        light.penumbra = lightData.penumbra;
+        light.angle = lightData.angle;
+    }
+
+    if(!this->uniformsUploaded || std::memcmp(&frame, &this->frameBlock, sizeof(FrameBlock)) != 0) {
+        this->frameBlock = frame;
+        glErrorCheck(glBindBuffer(GL_UNIFORM_BUFFER, this->frameUbo));
+        glErrorCheck(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &this->frameBlock));
+    }
+    if(!this->uniformsUploaded || std::memcmp(&lightBlocks, &this->lightsBlock, sizeof(LightsBlock)) != 0) {
+        this->lightsBlock = lightBlocks;
+        glErrorCheck(glBindBuffer(GL_UNIFORM_BUFFER, this->lightsUbo));
+        glErrorCheck(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightsBlock), &this->lightsBlock));
     }
-    glErrorCheck(glUniform1i(glGetUniformLocation(shader, "numLights"), i));
+    glErrorCheck(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+    this->uniformsUploaded = true;
 }
 
 std::vector<std::unique_ptr<Primitive>>& RealtimeScene::getPrimitives() {
@@ -5,11 +5,14 @@
 #include <vector>
 #include <memory>
 #include <random>
+#include <span>
 
 #include "GL/glew.h"
 #include "camera.h"
 #include "primitives.h"
+#include "rendermesh.h"
 #include "settings.h"
+#include "utils/shaderuniforms.h"
 
 class RealtimeScene {
 public:
@@ -20,17 +23,26 @@ public:
     void free() {
         this->primitives.clear();
         this->lights.clear();
+        glErrorCheck(glDeleteBuffers(1, &this->frameUbo));
+        glErrorCheck(glDeleteBuffers(1, &this->lightsUbo));
+        this->frameUbo = this->lightsUbo = 0;
     }
 
-    // Binds uniforms related to the scene
-    void bindSceneUniforms(GLuint shader);
+    // Uploads the scene's camera, global and light data (and the per-frame settings) into the uniform
+    // buffers shared by all shaders, wherever they have changed since the last upload
+    void updateSceneUniforms();
 
     // The getter of the scene's primitives
     std::vector<std::unique_ptr<Primitive>>& getPrimitives();
+    // The getter of the scene's jello cubes, which come after all other primitives
+    std::span<std::unique_ptr<Primitive>> getJelloCubes();
 
     void updateScene();
     void scatterCube();
     void addObstacle();
+    void addMovingObstacle();
+    void addTerrain();
+    void addJelloCube();
 
     // The getter of the shared pointer to the camera instance of the scene
     Camera& getCamera();
@@ -43,6 +55,32 @@ private:
     std::vector<std::unique_ptr<Primitive>> primitives;
     std::vector<SceneLightData> lights;
 
+    // std140 mirrors of the uniform blocks in phong.frag, as last uploaded
+    static const int maxLights = 8;
+    struct FrameBlock {
+        glm::mat4 viewMat, projMat;
+        glm::vec4 cameraPos;
+        GLfloat ka, kd, ks;
+        GLint textureMapEnabled;
+    };
+    struct LightBlock {
+        glm::vec4 color, pos, dir;
+        glm::vec3 function;
+        GLint type;
+        GLfloat penumbra, angle;
+        GLfloat padding[2];
+    };
+    struct LightsBlock {
+        LightBlock lights[maxLights];
+        GLint numLights;
+        GLint padding[3];
+    };
+    static_assert(sizeof(FrameBlock) == 160 && sizeof(LightBlock) == 80 && sizeof(LightsBlock) == 656, "uniform blocks must match std140");
+    FrameBlock frameBlock;
+    LightsBlock lightsBlock;
+    GLuint frameUbo = 0, lightsUbo = 0;
+    bool uniformsUploaded = false;
+
     SceneMaterial jelloMaterial = {
         .cAmbient = glm::vec4(0.2, 0.8, 0.2, 1),
         .cDiffuse = glm::vec4(0.2, 0.8, 0.2, 1),
@@ -68,6 +106,21 @@ private:
     };
 
 
+    // Primitives are ordered as: the bounding box, then any obstacles (starting with those from the scene file), then the jello cubes
+    int numSceneObstacles = 0;
+    std::vector<std::unique_ptr<Primitive>>::iterator getFirstJelloCube();
+
+    // Creates and initializes a jello cube at the given center; all cubes share one embedded render mesh, loaded from the scene
+    // file's jello mesh if it gives one, or otherwise a subdivided cube of this many cells per face side
+    std::unique_ptr<Primitive> makeJelloCube(glm::vec3 center);
+    std::shared_ptr<const RenderMesh> jelloRenderMesh;
+    std::string jelloMeshFile;
+    const int jelloRenderResolution = 128;
+
+    // Time (in seconds) that the obstacles' animations have advanced by; a double, as automatic
+    // timesteps can be small enough to be lost to a float's rounding over a long run
+    double time = 0;
+
     // For object generation
     std::mt19937 gen;
     float randFloat(float min, float max);
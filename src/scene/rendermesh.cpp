@@ -0,0 +1,97 @@
+#include "rendermesh.h"
+#include <unordered_map>
+#include <algorithm>
+
+std::shared_ptr<const RenderMesh> RenderMesh::subdividedCube(int resolution) {
+    std::shared_ptr<RenderMesh> mesh = std::make_shared<RenderMesh>();
+    int n = resolution;
+    for(int axis = 0; axis < 3; axis++) {
+        // Same grid layout, winding and UV orientation as JelloCube::calcSurfaceTopology
+        int uAxis = axis == 0 ? 1 : 0;
+        int vAxis = axis == 2 ? 1 : 2;
+        for(int side = 0; side < 2; side++) {
+            bool positive = side == 1;
+            bool ccw = positive != (axis == 1);
+            bool flipU = (axis == 0 && positive) || (axis == 2 && !positive);
+            bool flipV = axis == 1 && positive;
+            glm::vec3 normal(0);
+            normal[axis] = positive ? 1 : -1;
+
+            GLuint firstVertex = mesh->positions.size();
+            for(int a = 0; a <= n; a++) {
+                for(int b = 0; b <= n; b++) {
+                    float u = (float) a / n, v = (float) b / n;
+                    glm::vec3 pos;
+                    pos[axis] = positive ? 0.5 : -0.5;
+                    pos[uAxis] = u - 0.5f;
+                    pos[vAxis] = v - 0.5f;
+                    mesh->positions.push_back(pos);
+                    mesh->normals.push_back(normal);
+                    mesh->uvs.push_back(glm::vec2(flipU ? 1 - u : u, flipV ? 1 - v : v));
+                }
+            }
+            for(int a = 0; a < n; a++) {
+                for(int b = 0; b < n; b++) {
+                    GLuint v00 = firstVertex + a * (n + 1) + b;
+                    GLuint v10 = v00 + (n + 1), v01 = v00 + 1, v11 = v10 + 1;
+                    GLuint ccwCell[] = {v00, v10, v11, v00, v11, v01};
+                    GLuint cwCell[] = {v00, v11, v10, v00, v01, v11};
+                    GLuint* cell = ccw ? ccwCell : cwCell;
+                    mesh->indices.insert(mesh->indices.end(), cell, cell + 6);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+std::shared_ptr<const RenderMesh> RenderMesh::fromMeshData(const MeshData& data) {
+    std::shared_ptr<RenderMesh> mesh = std::make_shared<RenderMesh>();
+    if(data.positions.empty()) {
+        return mesh;
+    }
+
+    // Fit the mesh's bounding box into the unit cube, keeping its proportions
+    glm::vec3 boundsMin = data.positions[0], boundsMax = data.positions[0];
+    for(const glm::vec3& pos : data.positions) {
+        boundsMin = glm::min(boundsMin, pos);
+        boundsMax = glm::max(boundsMax, pos);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    float scale = 1 / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+
+    // Smooth normals for any corners which don't have their own
+    std::vector<glm::vec3> positionNormals;
+    bool missingNormals = std::find(data.normalInds.begin(), data.normalInds.end(), -1) != data.normalInds.end();
+    if(missingNormals) {
+        positionNormals.resize(data.positions.size(), glm::vec3(0));
+        for(size_t t = 0; t < data.numTriangles(); t++) {
+            const int* inds = &data.positionInds[3 * t];
+            glm::vec3 faceNormal = glm::cross(data.positions[inds[1]] - data.positions[inds[0]], data.positions[inds[2]] - data.positions[inds[0]]);
+            for(int c = 0; c < 3; c++) {
+                positionNormals[inds[c]] += faceNormal;
+            }
+        }
+    }
+
+    auto hashCorner = [](const glm::ivec3& corner) {
+        size_t hash = std::hash<int>()(corner.x);
+        hash = hash * 31 + std::hash<int>()(corner.y);
+        return hash * 31 + std::hash<int>()(corner.z);
+    };
+    std::unordered_map<glm::ivec3, GLuint, decltype(hashCorner)> vertices(data.positionInds.size() / 2, hashCorner);
+    mesh->indices.reserve(data.positionInds.size());
+    for(size_t c = 0; c < data.positionInds.size(); c++) {
+        glm::ivec3 corner(data.positionInds[c], data.uvInds[c], data.normalInds[c]);
+        auto [vertex, inserted] = vertices.try_emplace(corner, mesh->positions.size());
+        if(inserted) {
+            mesh->positions.push_back((data.positions[corner.x] - center) * scale);
+            mesh->uvs.push_back(corner.y >= 0 ? data.uvs[corner.y] : glm::vec2(0));
+            glm::vec3 normal = corner.z >= 0 ? data.normals[corner.z] : positionNormals[corner.x];
+            mesh->normals.push_back(glm::length(normal) > 0 ? glm::normalize(normal) : glm::vec3(0, 1, 0));
+        }
+        mesh->indices.push_back(vertex->second);
+    }
+    return mesh;
+}
@@ -0,0 +1,30 @@
+#ifndef RENDERMESH_H
+#define RENDERMESH_H
+
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "utils/objloader.h"
+
+// A triangle mesh for drawing a jello cube at a finer resolution than its lattice's. Positions are in the cube's rest frame,
+// where its lattice spans [-0.5, 0.5]^3 around the origin; unlike MeshData, each vertex has a single index for all its attributes.
+// Meshes are immutable once built, so that all cubes can share one.
+struct RenderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<GLuint> indices; // 3 per triangle, wound counterclockwise when seen from outside
+
+    // Builds the surface of the unit cube, with each face split into a grid of resolution^2 cells, and UV coordinates laid out
+    // as on a jello cube's lattice surface
+    static std::shared_ptr<const RenderMesh> subdividedCube(int resolution);
+
+    // Builds a render mesh from a loaded mesh, scaled uniformly and centered so that its bounding box fits the unit cube.
+    // Each distinct combination of a corner's indices becomes a vertex; corners without a normal get their position's
+    // area-weighted average normal, and those without UV coordinates get (0, 0).
+    static std::shared_ptr<const RenderMesh> fromMeshData(const MeshData& mesh);
+};
+
+#endif // RENDERMESH_H
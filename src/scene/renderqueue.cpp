@@ -0,0 +1,101 @@
+#include "renderqueue.h"
+#include "instancedrenderer.h"
+#include <algorithm>
+#include <bit>
+
+void RenderQueue::begin(glm::vec3 cameraPos) {
+    this->items.clear();
+    this->materials.clear();
+    this->cameraPos = cameraPos;
+}
+
+void RenderQueue::add(const Primitive& primitive, const ShaderUniforms& shader) {
+    this->push({0, &shader, 0, &primitive, primitive.getVao(), primitive.getTexture(), nullptr, -1});
+}
+
+void RenderQueue::addInstances(const InstancedRenderer& instances, int batch, const ShaderUniforms& shader) {
+    const Primitive& first = instances.getBatchPrimitive(batch);
+    this->push({0, &shader, 0, &first, instances.getBatchVao(batch), first.getTexture(), &instances, batch});
+}
+
+// Computes the item's sort key, and queues it. Opaque keys hold, from the most significant bit down: a clear transparency bit,
+// then the indices of the shader and material and the names of the texture and VAO; transparent keys hold a set transparency
+// bit, then the distance to the camera, inverted so that the furthest items come first.
+void RenderQueue::push(DrawItem item) {
+    auto shaderIt = std::find(this->shaders.begin(), this->shaders.end(), item.shader);
+    if(shaderIt == this->shaders.end()) {
+        shaderIt = this->shaders.insert(shaderIt, item.shader);
+    }
+    item.shaderIndex = shaderIt - this->shaders.begin();
+
+    const SceneMaterial& material = item.primitive->getMaterial();
+    if(material.cDiffuse.a < 1) {
+        float distance = glm::length(item.primitive->getBoundsCenter() - this->cameraPos);
+        item.key = (uint64_t(1) << 63) | (uint64_t(~std::bit_cast<uint32_t>(distance)) << 31);
+    } else {
+        auto materialIt = std::find_if(this->materials.begin(), this->materials.end(), [&](const SceneMaterial* other) {
+            return sameMaterial(*other, material);
+        });
+        if(materialIt == this->materials.end()) {
+            materialIt = this->materials.insert(materialIt, &material);
+        }
+        uint64_t materialIndex = materialIt - this->materials.begin();
+        item.key = ((uint64_t(item.shaderIndex) & 0x3f) << 57) | ((uint64_t(item.texture) & 0xfffff) << 37) |
+                   ((materialIndex & 0xffff) << 21) | (uint64_t(item.vao) & 0x1fffff);
+    }
+    this->items.push_back(item);
+}
+
+void RenderQueue::flush() {
+    // Stable, so that items with equal keys (such as transparent items equally far away) keep the order they were queued in
+    std::stable_sort(this->items.begin(), this->items.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.key < b.key;
+    });
+
+    // State bound so far this frame; the material is tracked per program, as uniforms are part of a program's state
+    this->stats = RenderStats();
+    const ShaderUniforms* boundShader = nullptr;
+    GLuint boundVao = 0, boundTexture = 0;
+    bool anyVao = false, anyTexture = false;
+    std::vector<const SceneMaterial*> boundMaterials(this->shaders.size(), nullptr);
+    glErrorCheck(glActiveTexture(GL_TEXTURE0));
+    for(const DrawItem& item : this->items) {
+        if(item.shader != boundShader) {
+            glErrorCheck(glUseProgram(item.shader->program));
+            boundShader = item.shader;
+            this->stats.programChanges++;
+        }
+        const SceneMaterial*& boundMaterial = boundMaterials[item.shaderIndex];
+        const SceneMaterial& material = item.primitive->getMaterial();
+        if(boundMaterial == nullptr || !sameMaterial(*boundMaterial, material)) {
+            item.primitive->bindMaterial(*item.shader);
+            boundMaterial = &material;
+            this->stats.materialChanges++;
+        }
+        // Untextured items don't sample their texture, so any texture will do
+        if(item.texture != 0 && (!anyTexture || item.texture != boundTexture)) {
+            glErrorCheck(glBindTexture(GL_TEXTURE_2D, item.texture));
+            boundTexture = item.texture;
+            anyTexture = true;
+            this->stats.textureChanges++;
+        }
+        if(!anyVao || item.vao != boundVao) {
+            glErrorCheck(glBindVertexArray(item.vao));
+            boundVao = item.vao;
+            anyVao = true;
+            this->stats.vaoChanges++;
+        }
+
+        if(item.instances != nullptr) {
+            item.instances->drawBatch(item.batch);
+        } else {
+            item.primitive->bindTransform(*item.shader);
+            item.primitive->drawGeometry(*item.shader);
+        }
+        this->stats.draws++;
+    }
+
+    glErrorCheck(glBindVertexArray(0));
+    glErrorCheck(glBindTexture(GL_TEXTURE_2D, 0));
+    glErrorCheck(glUseProgram(0));
+}
@@ -0,0 +1,66 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "primitives.h"
+#include "utils/shaderuniforms.h"
+
+class InstancedRenderer;
+
+// Number of state changes made by the render queue over a frame, out of the draw calls it made
+struct RenderStats {
+    int draws = 0;
+    int programChanges = 0;
+    int vaoChanges = 0;
+    int textureChanges = 0;
+    int materialChanges = 0;
+
+    bool operator==(const RenderStats& other) const = default;
+};
+
+// Collects a frame's draws, and issues them sorted to minimize state changes, skipping any binds and uniform uploads which
+// wouldn't change anything. Opaque draws are sorted by shader, then texture, then material, then VAO; transparent draws
+// (those whose diffuse color isn't opaque) come after all opaque ones, sorted back to front so that they blend correctly.
+class RenderQueue {
+public:
+    // Empties the queue, for a frame seen from the given camera position
+    void begin(glm::vec3 cameraPos);
+
+    // Queues a primitive, to be drawn with the given shader
+    void add(const Primitive& primitive, const ShaderUniforms& shader);
+    // Queues a batch of instances, to be drawn with the given (instanced) shader
+    void addInstances(const InstancedRenderer& instances, int batch, const ShaderUniforms& shader);
+
+    // Sorts and draws the queued items, then unbinds all state
+    void flush();
+
+    const RenderStats& getStats() const {
+        return this->stats;
+    }
+private:
+    struct DrawItem {
+        uint64_t key;
+        const ShaderUniforms* shader;
+        int shaderIndex; // into shaders
+        const Primitive* primitive; // for batches, the one whose material and texture are used
+        GLuint vao, texture;
+        const InstancedRenderer* instances; // if a batch of instances, along with the batch's index
+        int batch;
+    };
+    std::vector<DrawItem> items;
+    glm::vec3 cameraPos;
+
+    // Shaders and distinct materials seen by the queue, whose indices go into the sort keys;
+    // materials are only kept for the current frame
+    std::vector<const ShaderUniforms*> shaders;
+    std::vector<const SceneMaterial*> materials;
+    void push(DrawItem item);
+
+    RenderStats stats;
+};
+
+#endif // RENDERQUEUE_H
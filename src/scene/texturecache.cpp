@@ -0,0 +1,54 @@
+#include "texturecache.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+// Textures currently in use, by filename
+static std::unordered_map<std::string, std::weak_ptr<SharedTexture>> textureCache;
+
+// Upper bound on anisotropic filtering, past which sharper oblique surfaces aren't worth the extra samples
+static const GLfloat maxAnisotropy = 16;
+
+SharedTexture::~SharedTexture() {
+    glErrorCheck(glDeleteTextures(1, &this->texture));
+    textureCache.erase(this->filename);
+}
+
+QImage loadTextureImage(const std::string& filename) {
+    return QImage(filename.c_str()).convertToFormat(QImage::Format_RGBA8888).mirrored();
+}
+
+std::shared_ptr<SharedTexture> acquireTexture(const std::string& filename) {
+    std::weak_ptr<SharedTexture>& entry = textureCache[filename];
+    std::shared_ptr<SharedTexture> texture = entry.lock();
+    if(texture) {
+        return texture;
+    }
+
+    texture = std::make_shared<SharedTexture>();
+    texture->filename = filename;
+    entry = texture;
+    glErrorCheck(glGenTextures(1, &texture->texture));
+    glErrorCheck(glActiveTexture(GL_TEXTURE0));
+    glErrorCheck(glBindTexture(GL_TEXTURE_2D, texture->texture));
+
+    // The image goes out of scope once uploaded; a missing file gets a white texel, so that sampling it stays defined
+    QImage image = loadTextureImage(filename);
+    if(image.isNull()) {
+        std::cout << "could not load texture file " << filename << std::endl;
+        const GLubyte white[4] = {255, 255, 255, 255};
+        glErrorCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white));
+    } else {
+        glErrorCheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.constBits()));
+    }
+    glErrorCheck(glGenerateMipmap(GL_TEXTURE_2D));
+    glErrorCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    glErrorCheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    if(GLEW_EXT_texture_filter_anisotropic) {
+        GLfloat supported;
+        glErrorCheck(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &supported));
+        glErrorCheck(glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(supported, maxAnisotropy)));
+    }
+    glErrorCheck(glBindTexture(GL_TEXTURE_2D, 0));
+    return texture;
+}
@@ -0,0 +1,27 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+#include <QImage>
+#include "utils/debug.h"
+
+// A texture uploaded from an image file, shared by all primitives textured with that file; it's deleted (and dropped
+// from the cache) along with the last primitive using it
+struct SharedTexture {
+    std::string filename;
+    GLuint texture = 0;
+
+    ~SharedTexture();
+};
+
+// Loads the given image file as RGBA rows from bottom to top, as OpenGL expects them
+QImage loadTextureImage(const std::string& filename);
+
+// Returns the texture of the given image file, uploading it (with mipmaps and trilinear, anisotropic filtering)
+// if no primitive is using it yet; the image itself is only kept in memory while uploading
+std::shared_ptr<SharedTexture> acquireTexture(const std::string& filename);
+
+#endif // TEXTURECACHE_H
@@ -3,7 +3,13 @@
 
 enum class Integrator {
     EULER,
-    RK4
+    RK4,
+    MULTIRATE // symplectic Euler, with nodes near contacts taking several substeps per step
+};
+
+enum class ContactModel {
+    PENALTY,   // zero rest length springs pull penetrating nodes back to the surface
+    CONSTRAINT // penetrating nodes are projected back to the surface after each step, with Coulomb friction
 };
 
 struct Settings {
@@ -19,9 +25,24 @@ struct Settings {
     double mass = 0.01; // mass of each node (equal for all nodes)
     double gravity = 1; // gravity (acceleration downwards)
     Integrator integrator = Integrator::RK4;
+    ContactModel contactModel = ContactModel::CONSTRAINT;
+    double staticFriction = 0.6; // static friction coefficient, for constraint-based contacts
+    double dynamicFriction = 0.4; // dynamic friction coefficient, for constraint-based contacts
+    double contactSubsteps = 4; // substeps taken by nodes near contacts, for multirate integration
+    bool continuousCollisions = true; // whether to sweep fast nodes against obstacles, so that they can't tunnel through them
+    bool autoTimestep = false; // whether to replace dt with an estimate of the largest stable timestep
+    double timestepSafety = 0.9; // fraction of the estimated largest stable timestep to use
+    bool strainLimiting = false; // whether to clamp the springs' stretch after each step
+    double minStretch = 0.6; // minimum ratio of a spring's length to its rest length, under strain limiting
+    double maxStretch = 1.4; // maximum ratio of a spring's length to its rest length, under strain limiting
+    bool simulationLOD = true; // whether to simplify the simulation of cubes far from the camera
+    bool embeddedRenderMesh = true; // whether to draw cubes as a finer mesh deformed by their lattices, rather than the lattices' surfaces
 
     bool textureMappingEnabled = false;
     bool transparentCube = false;
+    bool renderStats = false; // whether to print the render queue's draw and state change counts, whenever they change
+
+    bool operator==(const Settings& other) const = default;
 };
 
 
@@ -0,0 +1,261 @@
+#include "objloader.h"
+
+#include <QFile>
+#include <QByteArray>
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// A range of whole lines of the file, along with the number of vertex attributes it declares,
+// and (once parsed) the face corners it declares
+struct Chunk {
+    const char* begin;
+    const char* end;
+    size_t numPositions = 0, numUVs = 0, numNormals = 0;
+    std::vector<int> positionInds, uvInds, normalInds;
+};
+
+const size_t minChunkSize = 1 << 20; // bytes
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while(p < end && isSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char* skipLine(const char* p, const char* end) {
+    while(p < end && *p != '\n') {
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// Parses a decimal number, with an optional sign, fraction and exponent; much faster than the standard library's
+// locale-aware parsers, and safe to use on the mapped file, which isn't null-terminated
+const char* parseFloat(const char* p, const char* end, float& value) {
+    static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20};
+    p = skipSpaces(p, end);
+    bool negative = p < end && *p == '-';
+    if(p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+    double mantissa = 0;
+    int exponent = 0;
+    while(p < end && isDigit(*p)) {
+        mantissa = mantissa * 10 + (*p++ - '0');
+    }
+    if(p < end && *p == '.') {
+        p++;
+        while(p < end && isDigit(*p)) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            exponent--;
+        }
+    }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExp = p < end && *p == '-';
+        if(p < end && (*p == '-' || *p == '+')) {
+            p++;
+        }
+        int exp = 0;
+        while(p < end && isDigit(*p)) {
+            exp = exp * 10 + (*p++ - '0');
+        }
+        exponent += negativeExp ? -exp : exp;
+    }
+    if(exponent < 0) {
+        mantissa /= -exponent <= 20 ? powersOf10[-exponent] : std::pow(10.0, -exponent);
+    } else if(exponent > 0) {
+        mantissa *= exponent <= 20 ? powersOf10[exponent] : std::pow(10.0, exponent);
+    }
+    value = (float) (negative ? -mantissa : mantissa);
+    return p;
+}
+
+const char* parseInt(const char* p, const char* end, int& value) {
+    bool negative = p < end && *p == '-';
+    if(p < end && (*p == '-' || *p == '+')) {
+        p++;
+    }
+    value = 0;
+    while(p < end && isDigit(*p)) {
+        value = value * 10 + (*p++ - '0');
+    }
+    value = negative ? -value : value;
+    return p;
+}
+
+// Converts a 1-based OBJ index (or a negative one, relative to the count so far) into a 0-based index, or -1 if invalid
+inline int resolveIndex(int index, size_t count) {
+    int resolved = index > 0 ? index - 1 : (int) count + index;
+    return resolved >= 0 && resolved < count ? resolved : -1;
+}
+
+// Counts the vertex attributes declared by a chunk, so that every chunk knows where its attributes go in the mesh
+void countChunk(Chunk& chunk) {
+    for(const char* p = chunk.begin; p < chunk.end; p = skipLine(p, chunk.end)) {
+        p = skipSpaces(p, chunk.end);
+        if(p + 1 < chunk.end && p[0] == 'v') {
+            chunk.numPositions += isSpace(p[1]);
+            chunk.numUVs += p[1] == 't';
+            chunk.numNormals += p[1] == 'n';
+        }
+    }
+}
+
+// Parses a chunk, writing its vertex attributes into the mesh starting at the given offsets (the totals of the previous
+// chunks), and keeping its face corners in the chunk until all chunks are done
+void parseChunk(Chunk& chunk, MeshData& mesh, size_t positionOffset, size_t uvOffset, size_t normalOffset) {
+    size_t numPositions = positionOffset, numUVs = uvOffset, numNormals = normalOffset;
+    std::vector<int> polygon; // resolved (position, uv, normal) indices of each of a face's corners
+    for(const char* p = chunk.begin; p < chunk.end; p = skipLine(p, chunk.end)) {
+        p = skipSpaces(p, chunk.end);
+        if(p + 1 >= chunk.end || !(isSpace(p[1]) || p[1] == 't' || p[1] == 'n')) {
+            continue;
+        }
+
+        if(p[0] == 'v' && isSpace(p[1])) {
+            glm::vec3& position = mesh.positions[numPositions++];
+            p = parseFloat(p + 1, chunk.end, position.x);
+            p = parseFloat(p, chunk.end, position.y);
+            p = parseFloat(p, chunk.end, position.z);
+        } else if(p[0] == 'v' && p[1] == 't') {
+            glm::vec2& uv = mesh.uvs[numUVs++];
+            p = parseFloat(p + 2, chunk.end, uv.x);
+            p = parseFloat(p, chunk.end, uv.y);
+        } else if(p[0] == 'v' && p[1] == 'n') {
+            glm::vec3& normal = mesh.normals[numNormals++];
+            p = parseFloat(p + 2, chunk.end, normal.x);
+            p = parseFloat(p, chunk.end, normal.y);
+            p = parseFloat(p, chunk.end, normal.z);
+        } else if(p[0] == 'f' && isSpace(p[1])) {
+            polygon.clear();
+            p = skipSpaces(p + 1, chunk.end);
+            while(p < chunk.end && *p != '\n' && *p != '#') {
+                int position = 0, uv = 0, normal = 0;
+                p = parseInt(p, chunk.end, position);
+                if(p < chunk.end && *p == '/') {
+                    if(++p < chunk.end && *p != '/') {
+                        p = parseInt(p, chunk.end, uv);
+                    }
+                    if(p < chunk.end && *p == '/') {
+                        p = parseInt(p + 1, chunk.end, normal);
+                    }
+                }
+                polygon.push_back(resolveIndex(position, numPositions));
+                polygon.push_back(uv == 0 ? -1 : resolveIndex(uv, numUVs));
+                polygon.push_back(normal == 0 ? -1 : resolveIndex(normal, numNormals));
+                // Skip anything else up to the next corner
+                while(p < chunk.end && !isSpace(*p) && *p != '\n') {
+                    p++;
+                }
+                p = skipSpaces(p, chunk.end);
+            }
+
+            // Triangulate as a fan around the first corner, dropping triangles with invalid positions
+            int numCorners = polygon.size() / 3;
+            for(int k = 1; k + 1 < numCorners; k++) {
+                int corners[3] = {0, k, k + 1};
+                if(polygon[0] < 0 || polygon[3 * k] < 0 || polygon[3 * (k + 1)] < 0) {
+                    continue;
+                }
+                for(int corner : corners) {
+                    chunk.positionInds.push_back(polygon[3 * corner]);
+                    chunk.uvInds.push_back(polygon[3 * corner + 1]);
+                    chunk.normalInds.push_back(polygon[3 * corner + 2]);
+                }
+            }
+        }
+    }
+}
+
+}
+
+bool ObjLoader::load(const std::string& filepath, MeshData& mesh) {
+    QFile file(QString::fromStdString(filepath));
+    if(!file.open(QIODevice::ReadOnly)) {
+        std::cout << "could not open mesh file " << filepath << std::endl;
+        return false;
+    }
+
+    // Map the file into memory, falling back to reading it whole where mapping isn't supported
+    qint64 size = file.size();
+    QByteArray contents;
+    const char* data = reinterpret_cast<const char*>(file.map(0, size));
+    if(data == nullptr) {
+        contents = file.readAll();
+        data = contents.constData();
+        size = contents.size();
+    }
+    const char* end = data + size;
+
+    // Split the file into chunks of whole lines, a few per thread so that uneven chunks balance out
+    size_t maxChunks = std::max(4 * std::thread::hardware_concurrency(), 1u);
+    size_t numChunks = std::clamp((size_t) size / minChunkSize, (size_t) 1, maxChunks);
+    std::vector<Chunk> chunks(numChunks);
+    const char* chunkBegin = data;
+    for(size_t c = 0; c < numChunks; c++) {
+        const char* chunkEnd = c + 1 == numChunks ? end : std::max(chunkBegin, data + size * (c + 1) / numChunks);
+        chunks[c].begin = chunkBegin;
+        chunks[c].end = chunkEnd == end ? end : skipLine(chunkEnd, end);
+        chunkBegin = chunks[c].end;
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int c = 0; c < numChunks; c++) {
+        countChunk(chunks[c]);
+    }
+
+    std::vector<size_t> positionOffsets(numChunks + 1, 0), uvOffsets(numChunks + 1, 0), normalOffsets(numChunks + 1, 0);
+    for(size_t c = 0; c < numChunks; c++) {
+        positionOffsets[c + 1] = positionOffsets[c] + chunks[c].numPositions;
+        uvOffsets[c + 1] = uvOffsets[c] + chunks[c].numUVs;
+        normalOffsets[c + 1] = normalOffsets[c] + chunks[c].numNormals;
+    }
+    mesh.positions.resize(positionOffsets[numChunks]);
+    mesh.uvs.resize(uvOffsets[numChunks]);
+    mesh.normals.resize(normalOffsets[numChunks]);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int c = 0; c < numChunks; c++) {
+        parseChunk(chunks[c], mesh, positionOffsets[c], uvOffsets[c], normalOffsets[c]);
+    }
+
+    // Concatenate the chunks' face corners
+    std::vector<size_t> cornerOffsets(numChunks + 1, 0);
+    for(size_t c = 0; c < numChunks; c++) {
+        cornerOffsets[c + 1] = cornerOffsets[c] + chunks[c].positionInds.size();
+    }
+    mesh.positionInds.resize(cornerOffsets[numChunks]);
+    mesh.uvInds.resize(cornerOffsets[numChunks]);
+    mesh.normalInds.resize(cornerOffsets[numChunks]);
+    #pragma omp parallel for
+    for(int c = 0; c < numChunks; c++) {
+        std::copy(chunks[c].positionInds.begin(), chunks[c].positionInds.end(), mesh.positionInds.begin() + cornerOffsets[c]);
+        std::copy(chunks[c].uvInds.begin(), chunks[c].uvInds.end(), mesh.uvInds.begin() + cornerOffsets[c]);
+        std::copy(chunks[c].normalInds.begin(), chunks[c].normalInds.end(), mesh.normalInds.begin() + cornerOffsets[c]);
+    }
+
+    if(contents.isEmpty()) {
+        file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+    }
+    if(mesh.numTriangles() == 0) {
+        std::cout << "mesh file " << filepath << " contains no triangles" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+// Struct which contains an indexed triangle mesh, as loaded from an OBJ file: its vertex attributes, and the indices
+// into them of each triangle corner (3 per triangle); uv and normal indices are -1 where the file doesn't give them
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+
+    std::vector<int> positionInds;
+    std::vector<int> uvInds;
+    std::vector<int> normalInds;
+
+    size_t numTriangles() const {
+        return this->positionInds.size() / 3;
+    }
+};
+
+class ObjLoader {
+public:
+    // Loads the vertices and faces of an OBJ file, triangulating any polygons as fans; other statements are ignored.
+    // The file is memory-mapped and split into chunks of whole lines, which are parsed in parallel.
+    // @param filepath  The path of the OBJ file to load.
+    // @param mesh      On return, this will contain the loaded mesh.
+    // @return          A boolean value indicating whether the load was successful.
+    static bool load(const std::string& filepath, MeshData& mesh);
+};
@@ -61,6 +61,10 @@ SceneCameraData ScenefileReader::getCameraData() const {
     return m_cameraData;
 }
 
+std::string ScenefileReader::getJelloMeshFile() const {
+    return m_jelloMeshFile;
+}
+
 SceneNode *ScenefileReader::getRootNode() const {
     return m_root;
 }
@@ -104,7 +108,7 @@ bool ScenefileReader::readJSON() {
     }
 
     QStringList requiredFields = {"globalData", "cameraData"};
-    QStringList optionalFields = {"name", "groups", "templateGroups"};
+    QStringList optionalFields = {"name", "groups", "templateGroups", "jelloMesh"};
     // If other fields are present, raise an error
     QStringList allFields = requiredFields + optionalFields;
     for (auto &field : scenefile.keys()) {
@@ -126,6 +130,17 @@ bool ScenefileReader::readJSON() {
         return false;
     }
 
+    // Parse the jello cubes' render mesh
+    if (scenefile.contains("jelloMesh")) {
+        if (!scenefile["jelloMesh"].isString()) {
+            std::cout << "jelloMesh must be of type string" << std::endl;
+            return false;
+        }
+        std::filesystem::path basepath = std::filesystem::path(file_name).parent_path().parent_path();
+        std::filesystem::path relativePath(scenefile["jelloMesh"].toString().toStdString());
+        m_jelloMeshFile = (basepath / relativePath).string();
+    }
+
     // Parse the template groups
     if (scenefile.contains("templateGroups")) {
         if (!parseTemplateGroups(scenefile["templateGroups"])) {
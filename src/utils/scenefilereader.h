@@ -24,6 +24,9 @@ public:
 
     SceneCameraData getCameraData() const;
 
+    // Path of the OBJ file to draw jello cubes with, or empty if the scene file doesn't give one
+    std::string getJelloMeshFile() const;
+
     SceneNode *getRootNode() const;
 
 private:
@@ -44,6 +47,7 @@ private:
 
     SceneGlobalData m_globalData;
     SceneCameraData m_cameraData;
+    std::string m_jelloMeshFile;
 
     SceneNode *m_root;
     std::vector<SceneNode *> m_nodes;
@@ -14,6 +14,7 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
 
     renderData.globalData = fileReader.getGlobalData();
     renderData.cameraData = fileReader.getCameraData();
+    renderData.jelloMeshFile = fileReader.getJelloMeshFile();
 
     renderData.shapes.clear();
     renderData.lights.clear();
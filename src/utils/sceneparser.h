@@ -17,6 +17,8 @@ struct RenderData {
 
     std::vector<SceneLightData> lights;
     std::vector<RenderShapeData> shapes;
+
+    std::string jelloMeshFile; // OBJ file to draw jello cubes with, or empty to draw them as subdivided cubes
 };
 
 class SceneParser {
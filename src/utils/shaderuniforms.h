@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Binding points of the uniform blocks shared by all shader programs (see phong.frag)
+const GLuint frameBlockBinding = 0;  // camera and global data, and per-frame settings
+const GLuint lightsBlockBinding = 1; // the scene's lights
+
+// A linked shader program, along with the locations of its per-draw uniforms, resolved once after linking
+// (-1 for uniforms the program doesn't use, which glUniform* calls ignore)
+struct ShaderUniforms {
+    GLuint program = 0;
+
+    GLint modelMat = -1, normalMat = -1;
+    GLint materialAmbient = -1, materialDiffuse = -1, materialSpecular = -1, materialShininess = -1;
+    GLint textured = -1, materialBlend = -1;
+    GLint nodeOffset = -1, embedded = -1, latticeSize = -1; // jello.vert only
+
+    // Resolves the uniforms of the given program, and binds its uniform blocks to their binding points
+    void resolve(GLuint program) {
+        this->program = program;
+        this->modelMat = glGetUniformLocation(program, "modelMat");
+        this->normalMat = glGetUniformLocation(program, "normalMat");
+        this->materialAmbient = glGetUniformLocation(program, "materialAmbient");
+        this->materialDiffuse = glGetUniformLocation(program, "materialDiffuse");
+        this->materialSpecular = glGetUniformLocation(program, "materialSpecular");
+        this->materialShininess = glGetUniformLocation(program, "materialShininess");
+        this->textured = glGetUniformLocation(program, "textured");
+        this->materialBlend = glGetUniformLocation(program, "materialBlend");
+        this->nodeOffset = glGetUniformLocation(program, "nodeOffset");
+        this->embedded = glGetUniformLocation(program, "embedded");
+        this->latticeSize = glGetUniformLocation(program, "latticeSize");
+
+        bindBlock("Frame", frameBlockBinding);
+        bindBlock("Lights", lightsBlockBinding);
+    }
+
+private:
+    void bindBlock(const char* name, GLuint binding) {
+        GLuint index = glGetUniformBlockIndex(this->program, name);
+        if(index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(this->program, index, binding);
+        }
+    }
+};
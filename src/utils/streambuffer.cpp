@@ -0,0 +1,98 @@
+#include "streambuffer.h"
+#include "debug.h"
+
+void StreamBuffer::allocate(GLsizeiptr size) {
+    this->free();
+    this->size = size;
+    this->region = 0;
+    glErrorCheck(glGenBuffers(1, &this->buffer));
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->buffer));
+
+    this->persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if(this->persistent) {
+        // Coherent, so that writes become visible to the GPU without explicit flushes
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glErrorCheck(glBufferStorage(GL_ARRAY_BUFFER, numRegions * size, nullptr, flags));
+        this->mapped = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, numRegions * size, flags));
+        glErrorCheck();
+        if(this->mapped == nullptr) {
+            // The buffer's storage is immutable, so start over with an ordinary buffer
+            glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+            glErrorCheck(glDeleteBuffers(1, &this->buffer));
+            glErrorCheck(glGenBuffers(1, &this->buffer));
+            glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->buffer));
+            this->persistent = false;
+        }
+    }
+    if(!this->persistent) {
+        glErrorCheck(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW));
+    }
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void StreamBuffer::free() {
+    for(GLsync& fence : this->fences) {
+        if(fence != nullptr) {
+            glErrorCheck(glDeleteSync(fence));
+            fence = nullptr;
+        }
+    }
+    if(this->buffer == 0) {
+        return;
+    }
+    if(this->mapped != nullptr) {
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->buffer));
+        glErrorCheck(glUnmapBuffer(GL_ARRAY_BUFFER));
+        glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        this->mapped = nullptr;
+    }
+    glErrorCheck(glDeleteBuffers(1, &this->buffer));
+    this->buffer = 0;
+}
+
+void* StreamBuffer::beginWrite() {
+    if(this->persistent) {
+        // Move on to the next region, waiting for the GPU to finish any draws from it
+        this->region = (this->region + 1) % numRegions;
+        GLsync& fence = this->fences[this->region];
+        if(fence != nullptr) {
+            GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while(status == GL_TIMEOUT_EXPIRED) {
+                status = glClientWaitSync(fence, 0, 1000000); // 1 ms
+            }
+            glErrorCheck(glDeleteSync(fence));
+            fence = nullptr;
+        }
+        return this->mapped + this->region * this->size;
+    }
+
+    // Orphan the buffer's storage, then map the fresh storage
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, this->buffer));
+    glErrorCheck(glBufferData(GL_ARRAY_BUFFER, this->size, nullptr, GL_STREAM_DRAW));
+    void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, this->size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glErrorCheck();
+    return data;
+}
+
+void StreamBuffer::endWrite() {
+    if(this->persistent) {
+        return;
+    }
+    // Unmapping can only fail if the storage was lost in the meantime (e.g. on a display mode change),
+    // in which case the next write replaces it anyway
+    glErrorCheck(glUnmapBuffer(GL_ARRAY_BUFFER));
+    glErrorCheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void StreamBuffer::fence() {
+    if(!this->persistent) {
+        return;
+    }
+    // A later fence also covers any earlier draws from the same region
+    GLsync& fence = this->fences[this->region];
+    if(fence != nullptr) {
+        glErrorCheck(glDeleteSync(fence));
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glErrorCheck();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <array>
+
+// A vertex buffer for data which the CPU rewrites every update, and the GPU reads every frame.
+// Where buffer storage is supported (GL 4.4, or ARB_buffer_storage), the buffer is a ring of regions which stays
+// persistently mapped, so that the CPU writes straight into the memory the GPU reads from; each region is fenced once
+// drawn from, and only waited on when the ring comes back around to it. Elsewhere (e.g. GL 4.1 on macOS), the buffer
+// is orphaned before every write, so that the driver hands out fresh memory rather than waiting for pending draws.
+class StreamBuffer {
+public:
+    ~StreamBuffer() {
+        this->free();
+    }
+
+    // (Re)creates the buffer, with room for the given number of bytes per write
+    void allocate(GLsizeiptr size);
+    // Deletes the buffer and any pending fences
+    void free();
+
+    // Returns where to write the next update's data (all of it, as the previous contents are undefined); the pointer is
+    // only valid until endWrite, which must be called before drawing
+    void* beginWrite();
+    void endWrite();
+    // Fences the region last written to, once the draw calls reading from it have been issued
+    void fence();
+
+    GLuint getBuffer() const {
+        return this->buffer;
+    }
+    // Returns the offset in bytes of the region last written to
+    GLintptr getOffset() const {
+        return this->persistent ? this->region * this->size : 0;
+    }
+private:
+    static const int numRegions = 3;
+    GLuint buffer = 0;
+    GLsizeiptr size = 0;
+    bool persistent = false;
+    char* mapped = nullptr; // the whole ring, if persistently mapped
+    int region = 0;
+    std::array<GLsync, numRegions> fences = {};
+};